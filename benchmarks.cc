@@ -0,0 +1,919 @@
+/* Benchmarks for the parts of the game that need to be fast. Build them with
+make bench and run ./benchmarks from the folder with the game's resources in
+it. With no arguments every benchmark is run; otherwise only the ones named
+are. Run the same benchmarks before and after a change to compare them. */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <queue>
+#include <atomic>
+#include <new>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "Map.hh"
+#include "MapFile.hh"
+#include "Mapgen.hh"
+#include "DroppedItem.hh"
+#include "AllTheItems.hh"
+#include "WindowHandler.hh"
+#include "Texture.hh"
+#include "filepaths.hh"
+#include "version.hh"
+
+using namespace std;
+
+/* The size of the benchmark world, which is the same as a generated Earth. */
+#define BENCH_WIDTH (2048 * 3)
+#define BENCH_HEIGHT 2048
+
+/* Counts the last-level cache misses of this process, if the kernel lets us.
+*/
+class CacheCounter {
+    int fd;
+
+public:
+    CacheCounter() {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~CacheCounter() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    void start() {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    /* Return the number of misses since start, or -1 if they can't be
+    counted. */
+    long long stop() {
+        long long count = -1;
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+                count = -1;
+            }
+        }
+        return count;
+    }
+};
+
+/* How many times memory has been allocated since the benchmarks started,
+counted by replacing the global operator new. */
+static atomic<long long> allocations(0);
+
+/* None of these are inlined, since gcc warns about mismatched allocation
+functions if it can see malloc and free inside them. */
+__attribute__((noinline)) void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t size) 
+        noexcept {
+    free(p);
+}
+
+/* Times a piece of a benchmark and prints how long it took. */
+class Timer {
+    string name;
+    CacheCounter misses;
+    chrono::steady_clock::time_point begin;
+
+public:
+    Timer(const string &name) : name(name) {
+        misses.start();
+        begin = chrono::steady_clock::now();
+    }
+
+    /* Print the results, with work being how many things were done. */
+    void stop(long long work) {
+        chrono::duration<double> seconds = chrono::steady_clock::now() - begin;
+        long long count = misses.stop();
+        cout << "  " << name << ": " << seconds.count() * 1000 << " ms";
+        if (work > 0) {
+            cout << ", " << seconds.count() * 1e9 / work << " ns each";
+        }
+        if (count >= 0) {
+            cout << ", " << count << " cache misses";
+        }
+        else {
+            cout << ", cache misses unavailable";
+        }
+        cout << "\n";
+    }
+};
+
+/* Return the foreground tile the benchmark world has at x, y. It's stone
+under a hilly surface, with caves and some torches. */
+static TileType benchForeground(int x, int y) {
+    int surface = BENCH_HEIGHT * 0.7 + 20 * sin(x / 40.0);
+    if (y > surface) {
+        return TileType::EMPTY;
+    }
+    unsigned int hash = (x * 73856093u) ^ (y * 19349663u);
+    if ((x / 8 + y / 6) % 5 == 0) {
+        return hash % 97 == 0 ? TileType::TORCH : TileType::EMPTY;
+    }
+    return y > surface - 10 ? TileType::DIRT : TileType::STONE;
+}
+
+/* The foreground, background, and sprite layers of the benchmark world,
+row by row. */
+struct BenchLayers {
+    vector<TileType> foreground;
+    vector<TileType> background;
+    vector<uint8_t> sprites;
+
+    BenchLayers() {
+        int size = BENCH_WIDTH * BENCH_HEIGHT;
+        foreground.resize(size);
+        background.resize(size);
+        sprites.resize(size, 0);
+        for (int y = 0; y < BENCH_HEIGHT; y++) {
+            for (int x = 0; x < BENCH_WIDTH; x++) {
+                foreground[y * BENCH_WIDTH + x] = benchForeground(x, y);
+                background[y * BENCH_WIDTH + x] = y > BENCH_HEIGHT * 0.7
+                    ? TileType::EMPTY : TileType::DIRT;
+            }
+        }
+    }
+};
+
+static const BenchLayers &getBenchLayers() {
+    static BenchLayers layers;
+    return layers;
+}
+
+/* Write the benchmark world to a savefile, so that it can be loaded the same
+way a real world would be. */
+static void writeBenchWorld(const string &filename) {
+    const BenchLayers &layers = getBenchLayers();
+    int chunksWide = (BENCH_WIDTH + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    int chunksHigh = (BENCH_HEIGHT + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    int biomesWide = BENCH_WIDTH / BIOME_SIZE + 1;
+    int biomesHigh = BENCH_HEIGHT / BIOME_SIZE + 1;
+
+    MapFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAP_FILE_MAGIC, MAP_FILE_MAGIC_SIZE);
+    header.formatVersion = MAP_FILE_VERSION;
+    header.major = MAJOR;
+    header.minor = MINOR;
+    header.patch = PATCH;
+    header.width = BENCH_WIDTH;
+    header.height = BENCH_HEIGHT;
+    header.spawnX = BENCH_WIDTH / 2;
+    header.spawnY = BENCH_HEIGHT * 0.9;
+    header.chunkSize = CHUNK_SIZE;
+    header.chunksWide = chunksWide;
+    header.chunksHigh = chunksHigh;
+    header.biomesWide = biomesWide;
+    header.biomesHigh = biomesHigh;
+
+    string data;
+    MapFile::writeValue(data, header);
+    size_t indexStart = data.size();
+    data.append(chunksWide * chunksHigh * sizeof(ChunkRecord), '\0');
+
+    header.biomeOffset = data.size();
+    vector<uint8_t> biomes(biomesWide * biomesHigh, 
+        (uint8_t)BiomeType::GRASSLAND);
+    MapFile::encodeLayer(data, biomes.data(), biomesWide, biomesHigh,
+        biomesWide);
+    header.biomeSize = data.size() - header.biomeOffset;
+    MapFile::writeValueAt(data, 0, header);
+
+    for (int j = 0; j < chunksHigh; j++) {
+        for (int i = 0; i < chunksWide; i++) {
+            int xstart = i * CHUNK_SIZE;
+            int ystart = j * CHUNK_SIZE;
+            int w = min(CHUNK_SIZE, BENCH_WIDTH - xstart);
+            int h = min(CHUNK_SIZE, BENCH_HEIGHT - ystart);
+            int start = ystart * BENCH_WIDTH + xstart;
+            ChunkRecord record;
+            record.offset = data.size();
+            MapFile::encodeLayer(data, &layers.foreground[start], w, h,
+                BENCH_WIDTH);
+            MapFile::encodeLayer(data, &layers.background[start], w, h,
+                BENCH_WIDTH);
+            MapFile::encodeLayer(data, &layers.sprites[start], w, h,
+                BENCH_WIDTH);
+            MapFile::encodeLayer(data, &layers.sprites[start], w, h,
+                BENCH_WIDTH);
+            record.size = data.size() - record.offset;
+            MapFile::writeValueAt(data, indexStart
+                + (j * chunksWide + i) * sizeof(ChunkRecord), record);
+        }
+    }
+
+    ofstream outfile(filename, ios::binary);
+    outfile.write(data.data(), data.size());
+}
+
+/* Return a freshly loaded copy of the benchmark world, with every chunk
+already loaded so that loading isn't what gets timed. */
+static Map *loadBenchWorld(const string &path) {
+    static bool written = false;
+    if (!written) {
+        writeBenchWorld("bench.world");
+        written = true;
+    }
+    Map *map = new Map("bench.world", 16, 16, path);
+    for (int x = 0; x < map -> getWidth(); x += CHUNK_SIZE) {
+        for (int y = 0; y < map -> getHeight(); y += CHUNK_SIZE) {
+            map -> getTileType(x, y, MapLayer::FOREGROUND);
+        }
+    }
+    return map;
+}
+
+/* Light screen-sized windows all over the map, underground and at the
+surface, the way setLight does when the player moves around. */
+static void benchLightingWalk(const string &path) {
+    Map *map = loadBenchWorld(path);
+    /* About how many tiles fit on a screen. */
+    const int w = 80;
+    const int h = 45;
+    int windows = 0;
+    Timer timer("setLight on fresh windows");
+    for (int x = 0; x + w < map -> getWidth(); x += 8 * w) {
+        for (int y = map -> getHeight() * 0.7 - 3 * h;
+                y < map -> getHeight() * 0.7 + h; y += h) {
+            map -> setLight(x, y, x + w, y + h);
+            windows++;
+        }
+    }
+    timer.stop(windows);
+    delete map;
+}
+
+/* Return a freshly loaded copy of a generated Earth world, generating it
+the first time. */
+static Map *loadEarthWorld(const string &path) {
+    static bool generated = false;
+    if (!generated) {
+        CreateState state;
+        mutex m;
+        Mapgen mapgen(path);
+        mapgen.generate("bench_earth.world", WorldType::EARTH, path, &state,
+            &m);
+        generated = true;
+    }
+    return new Map("bench_earth.world", 16, 16, path);
+}
+
+/* Return a hash of the light of every tile in a rectangle. */
+static uint64_t hashLight(Map &map, int xstart, int ystart, int xstop, 
+        int ystop) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int x = xstart; x < xstop; x++) {
+        for (int y = max(0, ystart); y < min(ystop, map.getHeight()); y++) {
+            Light light = map.getLight(x, y);
+            uint32_t value;
+            memcpy(&value, &light, sizeof(value));
+            hash = (hash ^ value) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+/* Light big screens on a generated Earth, then a screen full of torches,
+with setLight split over different numbers of threads. The light has to come
+out the same every time. */
+static void benchLightingThreads(const string &path) {
+    vector<int> counts = {1, 2, 4};
+    int cores = thread::hardware_concurrency();
+    if (cores > 4) {
+        counts.push_back(cores);
+    }
+    /* About how many tiles fit on a big screen. */
+    const int w = 160;
+    const int h = 90;
+    uint64_t expected = 0;
+    for (unsigned int i = 0; i < counts.size(); i++) {
+        Map *map = loadEarthWorld(path);
+        map -> setLightThreads(counts[i]);
+        int surface = map -> getHeight() * 0.7;
+        /* Load every chunk used first so that isn't what gets timed. */
+        for (int x = 0; x < map -> getWidth(); x += CHUNK_SIZE) {
+            for (int y = surface - 5 * h; y < surface + 2 * h; 
+                    y += CHUNK_SIZE) {
+                map -> getTileType(x, y, MapLayer::FOREGROUND);
+            }
+        }
+
+        int screens = 0;
+        uint64_t hash = 0;
+        {
+            Timer timer(to_string(counts[i]) + " threads, fresh screens");
+            for (int x = 0; x + w < map -> getWidth(); x += 4 * w) {
+                for (int y = surface - 4 * h; y < surface + h; y += h) {
+                    map -> setLight(x, y, x + w, y + h);
+                    screens++;
+                }
+            }
+            timer.stop(screens);
+        }
+        for (int x = 0; x + w < map -> getWidth(); x += 4 * w) {
+            hash ^= hashLight(*map, x, surface - 4 * h, x + w, surface + h);
+        }
+
+        /* Fill a cave-level screen with torches. */
+        int x = w;
+        int y = surface - 3 * h;
+        for (int i = x; i < x + w; i += 3) {
+            for (int j = y; j < y + h; j += 3) {
+                map -> setTile(i, j, MapLayer::FOREGROUND, TileType::TORCH);
+            }
+        }
+        {
+            Timer timer(to_string(counts[i]) + " threads, screen of torches");
+            map -> setLight(x, y, x + w, y + h);
+            timer.stop(1);
+        }
+        hash ^= hashLight(*map, x, y, x + w, y + h);
+
+        if (i == 0) {
+            expected = hash;
+        }
+        else if (hash != expected) {
+            cout << "  The light came out different on " << counts[i];
+            cout << " threads!\n";
+        }
+        delete map;
+    }
+    unlink("bench_earth.world");
+}
+
+/* Times one scripted lighting scenario and prints how long it took, how
+much work setLight did, how many allocations there were, and a hash of the
+light on screen at the end, which has to stay the same if lighting is only
+made faster. */
+class LightScenario {
+    string name;
+    Map &map;
+    long long startAllocations;
+    chrono::steady_clock::time_point begin;
+
+public:
+    LightScenario(const string &name, Map &map) : name(name), map(map) {
+        map.resetLightStats();
+        startAllocations = allocations;
+        begin = chrono::steady_clock::now();
+    }
+
+    /* Print the results, with frames being how many times setLight was
+    called, and return the hash of the screen. */
+    uint64_t stop(int frames, int xstart, int ystart, int xstop, int ystop) {
+        chrono::duration<double> seconds = chrono::steady_clock::now() - begin;
+        long long allocated = allocations - startAllocations;
+        LightStats stats = map.getLightStats();
+        uint64_t hash = hashLight(map, xstart, ystart, xstop, ystop);
+        cout << "  " << name << ": " << frames << " frames, ";
+        cout << seconds.count() * 1000 << " ms, ";
+        cout << seconds.count() * 1e6 / frames << " us per frame\n";
+        cout << "    " << stats.tilesChecked << " tiles checked, ";
+        cout << stats.tilesCleared << " tiles cleared, ";
+        cout << allocated << " allocations, light hash " << hash << "\n";
+        return hash;
+    }
+};
+
+/* Run scripted scenarios on the benchmark world the way the game would
+light them, one after another on the same map. Each one prints a hash of
+the light on screen at the end, and the last line combines them all. */
+static void benchLightingRegression(const string &path) {
+    Map *map = loadBenchWorld(path);
+    const int w = 80;
+    const int h = 45;
+    uint64_t total = 0;
+
+    /* Light a screen at the surface for the first time. */
+    int x = 1000;
+    int surface = map -> getSkyHeight(x + w / 2);
+    int y = surface - h / 2;
+    {
+        LightScenario scenario("initial screen", *map);
+        map -> setLight(x, y, x + w, y + h);
+        total ^= scenario.stop(1, x, y, x + w, y + h);
+    }
+
+    /* Place torches all over it, relighting after each one. */
+    {
+        const int torches = 50;
+        LightScenario scenario("placing " + to_string(torches) + " torches",
+            *map);
+        for (int i = 0; i < torches; i++) {
+            int tx = x + 3 + (i * 7) % (w - 6);
+            int ty = y + 2 + (i * 11) % (h - 4);
+            map -> setTile(tx, ty, MapLayer::FOREGROUND, TileType::TORCH);
+            map -> setLight(x, y, x + w, y + h);
+        }
+        total ^= scenario.stop(torches, x, y, x + w, y + h);
+    }
+
+    /* Dig straight up to the surface from deep underground, with the
+    screen following, until the sky comes in. */
+    {
+        const int depth = 200;
+        int tx = x + 5 * w;
+        int top = map -> getSkyHeight(tx);
+        LightScenario scenario("digging a " + to_string(depth) 
+            + "-tile tunnel to the surface", *map);
+        for (int ty = top - depth; ty < top; ty++) {
+            map -> setTile(tx, ty, MapLayer::FOREGROUND, TileType::EMPTY);
+            map -> setTile(tx, ty, MapLayer::BACKGROUND, TileType::EMPTY);
+            map -> setLight(tx - w / 2, ty - h / 2, tx + w / 2, ty + h / 2);
+        }
+        /* Check the last window lit, which is the one the sky came into. */
+        total ^= scenario.stop(depth, tx - w / 2, top - 1 - h / 2, 
+            tx + w / 2, top - 1 + h / 2);
+    }
+
+    /* Pan the camera along the surface across the place where the map wraps
+    around, the way renderMap asks for light. */
+    {
+        int frames = 0;
+        int last = 0;
+        y = map -> getSkyHeight(0) - h / 2;
+        LightScenario scenario("panning across the wrap seam", *map);
+        for (int camera = map -> getWidth() - 2 * w; 
+                camera < map -> getWidth() + w; camera += 2) {
+            last = camera % map -> getWidth();
+            map -> setLight(last, y, last + w, y + h);
+            frames++;
+        }
+        total ^= scenario.stop(frames, last, y, last + w, y + h);
+    }
+
+    cout << "  combined light hash " << total << "\n";
+    delete map;
+}
+
+/* Place torches and dig tunnels in a screen that's already lit, relighting
+it after each change, the way setLight does while the player is building. */
+static void benchRelight(const string &path) {
+    Map *map = loadBenchWorld(path);
+    const int w = 80;
+    const int h = 45;
+    int edits = 0;
+    Timer timer("setLight after each change");
+    for (int x = w; x + 2 * w < map -> getWidth(); x += 16 * w) {
+        int y = map -> getHeight() * 0.7 - 2 * h;
+        map -> setLight(x, y, x + w, y + h);
+        for (int i = 0; i < 40; i++) {
+            int tx = x + 10 + i;
+            int ty = y + h / 2;
+            if (i % 8 == 0) {
+                map -> setTile(tx, ty + 1, MapLayer::FOREGROUND, 
+                    TileType::TORCH);
+            }
+            map -> setTile(tx, ty, MapLayer::FOREGROUND, TileType::EMPTY);
+            map -> setLight(x, y, x + w, y + h);
+            edits++;
+        }
+    }
+    timer.stop(edits);
+    delete map;
+}
+
+/* Move a crowd of things that give off light around a lit screen, working
+out their light and reading every tile's light once a frame, the way
+rendering does. At 60 FPS a frame has about 16.7 ms. */
+static void benchDynamicLights(const string &path) {
+    Map *map = loadBenchWorld(path);
+    const int w = 80;
+    const int h = 45;
+    const int emitters = 128;
+    const int frames = 600;
+    int x = 4 * w;
+    int y = map -> getHeight() * 0.7 - h / 2;
+    map -> setLight(x, y, x + w, y + h);
+    Light torch(255, 128, 0, 0);
+    long long total = 0;
+    Timer timer(to_string(emitters) + " moving emitters, per frame");
+    for (int frame = 0; frame < frames; frame++) {
+        map -> clearEmitters();
+        for (int i = 0; i < emitters; i++) {
+            /* Each one wanders back and forth along its own path. */
+            double t = frame / 60.0 + i;
+            map -> addEmitter(x + w / 2 + (w / 2 + 8) * sin(t * 0.7 + i), 
+                y + h / 2 + (h / 2 + 8) * sin(t * 1.3), torch);
+        }
+        map -> setLight(x, y, x + w, y + h);
+        map -> setDynamicLight(x, y, x + w, y + h);
+        for (int i = x; i < x + w; i++) {
+            for (int j = y; j < y + h; j++) {
+                total += map -> getLight(i, j).r;
+            }
+        }
+    }
+    timer.stop(frames);
+    /* Use the total so the reads can't be skipped. */
+    if (total == 0) {
+        cout << "  Nothing was lit!\n";
+    }
+    delete map;
+}
+
+/* Walk the tiles under movables column by column, the way
+Collider::listCollisions does, plus the bordering check that picks
+sprites, which looks above and below each tile. */
+static void benchNeighbourhoodWalk(const string &path) {
+    Map *map = loadBenchWorld(path);
+    int solid = 0;
+    long long looked = 0;
+    {
+        Timer timer("collision walk");
+        for (int pass = 0; pass < 20; pass++) {
+            for (int x = pass; x < map -> getWidth(); x += 7) {
+                for (int y = 0; y < map -> getHeight(); y += 5) {
+                    /* About the size of the player, in tiles. */
+                    for (int k = x; k < x + 2; k++) {
+                        for (int j = y; j < min(y + 3, map -> getHeight());
+                                j++) {
+                            solid += map -> getForeground(k, j) -> getIsSolid();
+                            looked++;
+                        }
+                    }
+                }
+            }
+        }
+        timer.stop(looked);
+    }
+
+    looked = 0;
+    {
+        Timer timer("bordering, column by column");
+        Location place;
+        place.layer = MapLayer::FOREGROUND;
+        for (place.x = 0; place.x < map -> getWidth(); place.x++) {
+            for (place.y = 0; place.y < map -> getHeight(); place.y++) {
+                solid += map -> bordering(place);
+                looked++;
+            }
+        }
+        timer.stop(looked);
+    }
+    /* So the compiler can't skip anything. */
+    cout << "  (checksum " << solid << ")\n";
+    delete map;
+}
+
+/* The light kernel Map used before it was rewritten to use flat arrays,
+kept to compare against. It's the same except that it adds the light to its
+own grid instead of the map's, since that part is private. */
+static void oldSpreadLight(Map &map, int x, int y, const Light &l,
+        vector<vector<int>> &current, vector<vector<Light>> &lit) {
+    int mld = MAX_LIGHT_DEPTH;
+    queue<Location> unvisited;
+    unvisited.push({0, 0, MapLayer::FOREGROUND});
+    DLight lback = map.getBackground(x, y) -> getAbsorbed();
+    current[mld][mld] = max(map.getForeground(x, y) -> getAbsorbed().r, 
+        lback.r * lback.a);
+
+    while (!unvisited.empty()) {
+        Location loc = unvisited.front();
+        unvisited.pop();
+        if (loc.x >= mld || loc.y >= mld || loc.x <= -1 * mld 
+                || loc.y <= -1 * mld) {
+            continue;
+        }
+        int next = current[mld + loc.x][mld + loc.y];
+        if (next >= 64) {
+            continue;
+        }
+        Tile *fore = map.getTile(x + loc.x, y + loc.y, MapLayer::FOREGROUND);
+        Tile *back = map.getTile(x + loc.x, y + loc.y, MapLayer::BACKGROUND);
+        int opacity = max(fore -> getAbsorbed().r, 
+            back -> getAbsorbed().r * back -> getAbsorbed().a);
+        int edge = next + opacity;
+
+        vector<Location> edges = {{-1, 0, (MapLayer)0}, {0, -1, (MapLayer)0}, 
+            {1, 0, (MapLayer)0}, {0, 1, (MapLayer)0}};
+        vector<Location> corners = {{-1, -1, (MapLayer)0}, {1, -1, (MapLayer)0},
+            {-1, 1, (MapLayer)0}, {1, 1, (MapLayer)0}};
+        for (int i = 0; i < 4; i++) {
+            int ix = mld + loc.x + edges[i].x;
+            int iy = mld + loc.y + edges[i].y;
+            if (current[ix][iy] == -1) {
+                current[ix][iy] = edge;
+                unvisited.push({ix - mld, iy - mld, (MapLayer)0});
+            }
+            else {
+                current[ix][iy] = min(current[ix][iy], edge);
+            }
+            int cx = mld + loc.x + corners[i].x;
+            int cy = mld + loc.y + corners[i].y;
+            Tile *cfore = map.getForeground(x + cx - mld, y + cy - mld);
+            Tile *cback = map.getBackground(x + cx - mld, y + cy - mld);
+            int copacity = max(cfore -> getAbsorbed().r, 
+                cback -> getAbsorbed().r * cback -> getAbsorbed().a);
+            int ccorner = next + 1.41 * (copacity + opacity) / 2.0;
+            if (current[cx][cy] == -1) {
+                current[cx][cy] = ccorner;
+                unvisited.push({cx - mld, cy - mld, (MapLayer)0});
+            }
+            else {
+                current[cx][cy] = min(current[cx][cy], ccorner);
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < current.size(); i++) {
+        for (unsigned int j = 0; j < current[i].size(); j++) {
+            if (current[i][j] != -1) {
+                int n = current[i][j];
+                double coef = 0;
+                if (n < MAX_OPACITY) {
+                    coef = exp(-1 * n * n / (MAX_OPACITY * MAX_OPACITY / 4.0));
+                }
+                lit[i][j].setmax(l.times(coef));
+                current[i][j] = -1;
+            }
+        }
+    }
+}
+
+/* Spread light from sources all over the underground and the surface, with
+the kernel from before and after it used flat arrays. */
+static void benchLightKernel(const string &path) {
+    Map *map = loadBenchWorld(path);
+    Light torch(255, 200, 120, 255);
+    int low = map -> getHeight() / 2;
+    int high = map -> getHeight() * 0.7 + 100;
+    int sources = 0;
+    chrono::duration<double> seconds;
+
+    vector<vector<int>> current(LIGHT_GRID_SIZE, 
+        vector<int>(LIGHT_GRID_SIZE, -1));
+    vector<vector<Light>> lit(LIGHT_GRID_SIZE, 
+        vector<Light>(LIGHT_GRID_SIZE));
+    {
+        Timer timer("queue and nested vectors");
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        for (int x = 0; x < map -> getWidth(); x += 3) {
+            for (int y = low; y < high; y += 7) {
+                oldSpreadLight(*map, x, y, torch, current, lit);
+                sources++;
+            }
+        }
+        seconds = chrono::steady_clock::now() - begin;
+        timer.stop(sources);
+    }
+    cout << "  " << sources / seconds.count() / 1000;
+    cout << " light sources per ms\n";
+
+    sources = 0;
+    {
+        Timer timer("flat arrays");
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        for (int x = 0; x < map -> getWidth(); x += 3) {
+            for (int y = low; y < high; y += 7) {
+                map -> spreadLight(x, y, torch);
+                sources++;
+            }
+        }
+        seconds = chrono::steady_clock::now() - begin;
+        timer.stop(sources);
+    }
+    cout << "  " << sources / seconds.count() / 1000;
+    cout << " light sources per ms\n";
+    delete map;
+}
+
+/* Print how much memory the benchmark world's tiles take, right after it's
+loaded and once every chunk has been used. */
+static void benchMemory(const string &path) {
+    Map *map = loadBenchWorld(path);
+    double tiles = (double)map -> getWidth() * map -> getHeight();
+    cout << "  " << sizeof(Chunk) / (double)CHUNK_AREA << " bytes per tile\n";
+    cout << "  " << map -> getMemoryUsage() / 1e6 << " MB for ";
+    cout << tiles / 1e6 << " million tiles\n";
+    delete map;
+
+    map = new Map("bench.world", 16, 16, path);
+    cout << "  " << map -> getMemoryUsage() / 1e6 << " MB before any chunks ";
+    cout << "are used\n";
+    delete map;
+}
+
+/* Print how fast a number of bytes were handled in some number of seconds.
+*/
+static void printSpeed(const string &name, double bytes, 
+        chrono::duration<double> seconds) {
+    cout << "  " << name << ": " << bytes / 1e6 / seconds.count();
+    cout << " MB/s\n";
+}
+
+/* Run work(band) for each band from 0 to count - 1, each on its own
+thread, and return how long it took. */
+static chrono::duration<double> runBands(int count, 
+        const function<void(int)> &work) {
+    auto begin = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int band = 1; band < count; band++) {
+        workers.emplace_back(work, band);
+    }
+    work(0);
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    return chrono::steady_clock::now() - begin;
+}
+
+/* Compress and decompress the foreground layer of the benchmark world, a
+band of rows per thread, and then time a whole save. */
+static void benchLayerCodec(const string &path) {
+    const BenchLayers &layers = getBenchLayers();
+    double bytes = layers.foreground.size() * sizeof(TileType);
+    vector<int> threadCounts = {1};
+    if (thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(thread::hardware_concurrency());
+    }
+
+    for (unsigned int i = 0; i < threadCounts.size(); i++) {
+        int count = threadCounts[i];
+        vector<string> bands(count);
+        vector<TileType> decoded(layers.foreground.size());
+        vector<char> correct(count);
+        auto rows = [&](int band, int &ystart, int &ystop) {
+            ystart = band * BENCH_HEIGHT / count;
+            ystop = (band + 1) * BENCH_HEIGHT / count;
+        };
+
+        string threads = to_string(count) + (count == 1 ? " thread" 
+            : " threads");
+        printSpeed("encode, " + threads, bytes, runBands(count, [&](int band) {
+            int ystart, ystop;
+            rows(band, ystart, ystop);
+            MapFile::encodeLayer(bands[band], 
+                &layers.foreground[ystart * BENCH_WIDTH], BENCH_WIDTH, 
+                ystop - ystart, BENCH_WIDTH);
+        }));
+        printSpeed("decode, " + threads, bytes, runBands(count, [&](int band) {
+            int ystart, ystop;
+            rows(band, ystart, ystop);
+            const char *p = bands[band].data();
+            correct[band] = MapFile::decodeLayer(p, p + bands[band].size(),
+                &decoded[ystart * BENCH_WIDTH], BENCH_WIDTH, ystop - ystart,
+                BENCH_WIDTH);
+        }));
+        if (std::count(correct.begin(), correct.end(), false) 
+                || decoded != layers.foreground) {
+            cout << "  decoded layer doesn't match!\n";
+        }
+    }
+
+    Map *map = loadBenchWorld(path);
+    /* Every layer that gets saved. */
+    bytes = (double)map -> getWidth() * map -> getHeight() 
+        * (2 * sizeof(TileType) + 2);
+    auto begin = chrono::steady_clock::now();
+    map -> save("bench_copy.world");
+    printSpeed("whole save", bytes, chrono::steady_clock::now() - begin);
+    delete map;
+    unlink("bench_copy.world");
+}
+
+/* Strip-mine tunnels through the stone, the way a player breaking blocks
+does, and count how many blocks get mined each second. Each one drops an
+item. */
+static void benchMining(const string &path) {
+    Map *map = loadBenchWorld(path);
+    vector<DroppedItem*> items;
+    int mined = 0;
+    Timer timer("kill, dropping an item");
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    for (int y = map -> getHeight() / 4; y < map -> getHeight() / 2; y += 16) {
+        for (int x = 0; x < map -> getWidth(); x++) {
+            if (map -> getTileType(x, y, MapLayer::FOREGROUND)
+                    != TileType::EMPTY) {
+                map -> kill(x, y, MapLayer::FOREGROUND, items);
+                mined++;
+            }
+        }
+        /* Don't let the dropped items pile up more than a player would. */
+        for (unsigned int i = 0; i < items.size(); i++) {
+            delete items[i];
+        }
+        items.clear();
+    }
+    chrono::duration<double> seconds = chrono::steady_clock::now() - begin;
+    timer.stop(mined);
+    cout << "  " << mined / seconds.count() << " blocks mined per second\n";
+    delete map;
+}
+
+/* Print how a texture or font cache did. */
+static void printCacheStats(const string &name, const CacheStats &stats) {
+    cout << "  " << name << ": " << stats.lookups << " lookups, ";
+    cout << stats.hits << " hits, " << stats.misses << " misses\n";
+}
+
+/* Look up already loaded textures and fonts over and over, the way the UI
+does when it gets rebuilt, with every tile's texture loaded too. */
+static void benchTextureCache(const string &path) {
+    Map *map = loadBenchWorld(path);
+    cout << "  " << Texture::getLoadedCount() << " textures loaded\n";
+    vector<string> names = {"bunny.png", "frame.png", "inventory.png",
+        "stat_bar_overlay.png", "trash.png"};
+    /* The UI keeps these loaded. */
+    vector<Texture> held;
+    for (unsigned int i = 0; i < names.size(); i++) {
+        held.emplace_back(path + UI_SPRITE_PATH + names[i]);
+    }
+    const int repeats = 20000;
+    {
+        Timer timer("textures by filename");
+        for (int i = 0; i < repeats; i++) {
+            Texture texture(path + UI_SPRITE_PATH + names[i % names.size()]);
+        }
+        timer.stop(repeats);
+    }
+    {
+        Timer timer("text textures");
+        for (int i = 0; i < repeats; i++) {
+            Texture texture(to_string(i % 100), 10 + i % 4, 0);
+        }
+        timer.stop(repeats);
+    }
+    printCacheStats("textures", Texture::getTextureStats());
+    printCacheStats("fonts", Texture::getFontStats());
+    delete map;
+}
+
+struct Benchmark {
+    string name;
+    void (*run)(const string &path);
+};
+
+int main(int argc, char **argv) {
+    /* Nothing is drawn, but tiles need a renderer to load their sprites. */
+    setenv("SDL_VIDEODRIVER", "dummy", 0);
+    WindowHandler window(64, 64, 16, 16);
+    string path = "./";
+
+    vector<Benchmark> benchmarks = {
+        {"lighting-walk", benchLightingWalk},
+        {"light-kernel", benchLightKernel},
+        {"relight", benchRelight},
+        {"dynamic-lights", benchDynamicLights},
+        {"lighting-regression", benchLightingRegression},
+        {"lighting-threads", benchLightingThreads},
+        {"neighbourhood-walk", benchNeighbourhoodWalk},
+        {"memory", benchMemory},
+        {"layer-codec", benchLayerCodec},
+        {"mining", benchMining},
+        {"texture-cache", benchTextureCache},
+    };
+
+    for (unsigned int i = 0; i < benchmarks.size(); i++) {
+        bool chosen = argc == 1;
+        for (int j = 1; j < argc; j++) {
+            chosen = chosen || benchmarks[i].name == argv[j];
+        }
+        if (chosen) {
+            cout << benchmarks[i].name << ":\n";
+            benchmarks[i].run(path);
+        }
+    }
+
+    unlink("bench.world");
+    ItemMaker::clearPrototypes();
+    Texture::closeFonts();
+    return 0;
+}
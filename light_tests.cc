@@ -0,0 +1,47 @@
+/* Make sure light falls off the way it should. */
+
+#define CATCH_CONFIG_MAIN // Tells catch to provide a main()
+#include "catch.hpp"
+#include <cmath>
+#include <cstdlib>
+#include "Map.hh"
+
+/* Return how much of a light value is left after n of it is absorbed, worked
+out with doubles the way it was before the table was integers. */
+static int exactFalloff(int value, int n) {
+    if (n >= MAX_OPACITY) {
+        return 0;
+    }
+    double coef = exp(-1 * n * n / (MAX_OPACITY * MAX_OPACITY / 4.0));
+    return (uint8_t)(value * std::min(1.0, std::max(coef, 0.0)));
+}
+
+TEST_CASE("integer light falloff", "[light]") {
+    SECTION("within 1 of the exact falloff") {
+        for (int n = 0; n <= MAX_OPACITY; n++) {
+            for (int value = 0; value < 256; value++) {
+                Light light(value, 255 - value, value / 2, value);
+                Light scaled = light.scale(Map::getFalloff(n));
+                REQUIRE(abs(scaled.r - exactFalloff(light.r, n)) <= 1);
+                REQUIRE(abs(scaled.g - exactFalloff(light.g, n)) <= 1);
+                REQUIRE(abs(scaled.b - exactFalloff(light.b, n)) <= 1);
+                REQUIRE(abs(scaled.a - exactFalloff(light.a, n)) <= 1);
+            }
+        }
+    }
+
+    SECTION("nothing absorbed leaves the light alone") {
+        Light light(255, 128, 7, 200);
+        REQUIRE(light.scale(Map::getFalloff(0)) == light);
+    }
+
+    SECTION("MAX_OPACITY absorbed leaves nothing") {
+        REQUIRE(Map::getFalloff(MAX_OPACITY) == 0);
+    }
+
+    SECTION("more absorbed never leaves more light") {
+        for (int n = 1; n <= MAX_OPACITY; n++) {
+            REQUIRE(Map::getFalloff(n) <= Map::getFalloff(n - 1));
+        }
+    }
+}
@@ -0,0 +1,180 @@
+/* Make sure maps come back out of a savefile the same as they went in. */
+
+#define CATCH_CONFIG_MAIN // Tells catch to provide a main()
+#include "catch.hpp"
+#include <fstream>
+#include <mutex>
+#include <vector>
+#include "Map.hh"
+#include "MapFile.hh"
+#include "Mapgen.hh"
+#include "WindowHandler.hh"
+
+/* Tiles need a renderer to load their sprites. */
+static WindowHandler &getWindow() {
+    static WindowHandler window(64, 64, 16, 16);
+    return window;
+}
+
+/* Return true if every tile, sprite, and biome of both maps is the same. */
+static bool sameMap(Map &one, Map &two) {
+    if (one.getWidth() != two.getWidth()
+            || one.getHeight() != two.getHeight()
+            || one.getSpawn().x != two.getSpawn().x
+            || one.getSpawn().y != two.getSpawn().y) {
+        return false;
+    }
+    for (int x = 0; x < one.getWidth(); x++) {
+        for (int y = 0; y < one.getHeight(); y++) {
+            MapLayer fore = MapLayer::FOREGROUND;
+            MapLayer back = MapLayer::BACKGROUND;
+            if (one.getTileType(x, y, fore) != two.getTileType(x, y, fore)
+                    || one.getTileType(x, y, back)
+                    != two.getTileType(x, y, back)
+                    || one.getForegroundSprite(x, y)
+                    != two.getForegroundSprite(x, y)
+                    || one.getBackgroundSprite(x, y)
+                    != two.getBackgroundSprite(x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+TEST_CASE("save and load a map", "[save]") {
+    getWindow();
+    std::string path = "./";
+
+    SECTION("binary round trip") {
+        CreateState state;
+        std::mutex m;
+        Mapgen mapgen(path);
+        mapgen.generate("save_test.world", WorldType::TEST, path, &state, &m);
+
+        Map map("save_test.world", 16, 16, path);
+        /* Change a few tiles so not everything is in long runs. */
+        map.setTile(3, 40, MapLayer::FOREGROUND, TileType::GLOWSTONE);
+        map.setTile(100, 2, MapLayer::BACKGROUND, TileType::DIRT);
+        map.setTile(127, 63, MapLayer::FOREGROUND, TileType::TORCH);
+        map.save("save_test.world");
+
+        Map loaded("save_test.world", 16, 16, path);
+        REQUIRE(sameMap(map, loaded));
+
+        /* Chunks that were never loaded get copied over as they are. */
+        Map untouched("save_test.world", 16, 16, path);
+        untouched.save("save_test_copy.world");
+        Map copy("save_test_copy.world", 16, 16, path);
+        REQUIRE(sameMap(map, copy));
+    }
+
+    SECTION("autosave only writes changed chunks") {
+        CreateState state;
+        std::mutex m;
+        Mapgen mapgen(path);
+        mapgen.generate("save_test.world", WorldType::TEST, path, &state, &m);
+        std::ifstream before("save_test.world", std::ios::binary);
+        MapFileHeader header;
+        before.read((char *)&header, sizeof(header));
+        int chunks = header.chunksWide * header.chunksHigh;
+        std::vector<ChunkRecord> oldRecords(chunks);
+        before.read((char *)oldRecords.data(), chunks * sizeof(ChunkRecord));
+        before.seekg(0, std::ios::end);
+        long fullSize = before.tellg();
+
+        Map expected("save_test.world", 16, 16, path);
+        {
+            Map map("save_test.world", 16, 16, path);
+            map.setTile(3, 40, MapLayer::FOREGROUND, TileType::GLOWSTONE);
+            expected.setTile(3, 40, MapLayer::FOREGROUND, TileType::GLOWSTONE);
+            map.autosave("save_test.world");
+            /* Nothing changed since the last one. */
+            map.autosave("save_test.world");
+            /* The autosave finishes before the map is deleted. */
+        }
+
+        /* Only the changed chunk was added to the end of the file, once,
+        and only its entry in the index points somewhere new. */
+        std::ifstream after("save_test.world", std::ios::binary);
+        after.seekg(sizeof(MapFileHeader));
+        std::vector<ChunkRecord> newRecords(chunks);
+        after.read((char *)newRecords.data(), chunks * sizeof(ChunkRecord));
+        after.seekg(0, std::ios::end);
+        int changed = (40 / CHUNK_SIZE) * header.chunksWide + 3 / CHUNK_SIZE;
+        for (int i = 0; i < chunks; i++) {
+            if (i == changed) {
+                REQUIRE(newRecords[i].offset == (uint64_t)fullSize);
+                REQUIRE((long)after.tellg() 
+                    == fullSize + (long)newRecords[i].size);
+            }
+            else {
+                REQUIRE(newRecords[i].offset == oldRecords[i].offset);
+                REQUIRE(newRecords[i].size == oldRecords[i].size);
+            }
+        }
+
+        Map loaded("save_test.world", 16, 16, path);
+        REQUIRE(sameMap(expected, loaded));
+    }
+
+    SECTION("background saves keep the state they started with") {
+        CreateState state;
+        std::mutex m;
+        Mapgen mapgen(path);
+        mapgen.generate("save_test.world", WorldType::TEST, path, &state, &m);
+
+        Map map("save_test.world", 16, 16, path);
+        Map expected("save_test.world", 16, 16, path);
+        map.setTile(10, 10, MapLayer::FOREGROUND, TileType::EMPTY);
+        expected.setTile(10, 10, MapLayer::FOREGROUND, TileType::EMPTY);
+        map.saveInBackground("save_test_background.world");
+
+        /* Keep changing the map while it's being saved. */
+        for (int x = 0; x < map.getWidth(); x++) {
+            map.setTile(x, 20, MapLayer::FOREGROUND, TileType::GLASS);
+            map.setTile(x, 50, MapLayer::BACKGROUND, TileType::DIRT);
+        }
+        map.finishSave();
+
+        Map loaded("save_test_background.world", 16, 16, path);
+        REQUIRE(sameMap(expected, loaded));
+        REQUIRE(!sameMap(map, loaded));
+    }
+
+    SECTION("old text savefiles") {
+        /* A 4 x 3 map with a row of stone, then granite over empty
+        space. */
+        std::ofstream outfile("save_test_text.world");
+        outfile << "#Map\n0 10 11\n4 3\n2 2\n1234\n";
+        outfile << "#Foreground\n4 8 2 9 6 0 \n";
+        outfile << "#Background\n12 0 \n";
+        outfile << "#Biomes\n1 2 \n";
+        outfile << "#Other\n";
+        for (int i = 0; i < 12; i++) {
+            outfile << i << " 0 ";
+        }
+        outfile.close();
+
+        Map text("save_test_text.world", 16, 16, path);
+        REQUIRE(text.getWidth() == 4);
+        REQUIRE(text.getHeight() == 3);
+        REQUIRE(text.getTileType(2, 0, MapLayer::FOREGROUND)
+            == TileType::STONE);
+        REQUIRE(text.getTileType(1, 1, MapLayer::FOREGROUND)
+            == TileType::GRANITE);
+        REQUIRE(text.getTileType(2, 1, MapLayer::FOREGROUND)
+            == TileType::EMPTY);
+        REQUIRE(text.getForegroundSprite(3, 2) == 11);
+
+        /* It gets saved in the binary format. */
+        text.save("save_test_text.world");
+        std::ifstream infile("save_test_text.world");
+        std::string magic(MAP_FILE_MAGIC_SIZE, '\0');
+        infile.read(&magic[0], MAP_FILE_MAGIC_SIZE);
+        REQUIRE(magic == MAP_FILE_MAGIC);
+
+        Map binary("save_test_text.world", 16, 16, path);
+        REQUIRE(sameMap(text, binary));
+    }
+}
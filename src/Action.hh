@@ -69,9 +69,6 @@ enum class InputType {
 /* A class for storing things that can go on the hotbar (items, skills). */
 class Action {
 protected:
-    /* Minimum time before another action can be done. */
-    int useTime;
-
     /* Which action it is. */
     ActionType type;
 
@@ -82,17 +79,17 @@ public:
     // Virtual destructor
     inline virtual ~Action() {};
 
-    /* What sprite should be displayed in the hotbar or inventory. */
-    Sprite sprite;
-
     /* Do the action, or use the item or skill. */
     virtual void 
             use(InputType type, int x, int y, World &world) = 0;
 
+    /* Minimum time before another action can be done. */
+    virtual int getUseTime() const = 0;
+
+    /* What sprite should be displayed in the hotbar or inventory. */
+    virtual const Sprite &getSprite() const = 0;
+
     /* Access functions */
-    inline int getUseTime() const {
-        return useTime;
-    }
 
     inline ActionType getType() const {
         return type;
@@ -2,11 +2,13 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include "AllTheItems.hh"
 #include "Player.hh"
 #include "Map.hh"
 #include "World.hh"
 #include "json.hh"
+#include "AssetBundle.hh"
 
 #define TILE_WIDTH 16
 #define TILE_HEIGHT 16
@@ -14,18 +16,19 @@
 using json = nlohmann::json;
 using namespace std;
 
-// Potion constructor
-Potion::Potion(ActionType type, string path) : Item(type, path) {
-    /* Figure out which json file to use. */
-    std::string filename = path + Item::getJsonFilename(type);
-
-    /* Put the data into the json. */
-    std::ifstream infile(filename);
-    /* Check that the file could be opened. */
-    if (!infile) {
-        cerr << "Can't open " << filename << "\n";
-    }
-    json j = json::parse(infile);
+/* The prototype for each ActionType, or nullptr if it hasn't been made yet.
+*/
+static vector<ItemPrototype *> prototypes((int)ActionType::LAST_ITEM + 1,
+    nullptr);
+
+/* For multithreaded access to the prototypes. */
+static mutex prototypesMutex;
+
+// Potion prototype constructor
+PotionPrototype::PotionPrototype(ActionType type, const string &path)
+        : ItemPrototype(type, path) {
+    /* Get the data from the right json file. */
+    const json &j = AssetBundle::getJson(path + Item::getJsonFilename(type));
 
     /* Set values equal to the json's values. */
     healthGained = j["healthGained"];
@@ -36,37 +39,40 @@ Potion::Potion(ActionType type, string path) : Item(type, path) {
     manaCured = j["manaCured"];
 }
 
+Item *PotionPrototype::makeItem() const {
+    return new Potion(*this);
+}
+
+// Potion constructor
+Potion::Potion(const PotionPrototype &prototype) : Item(prototype),
+        potion(prototype) {}
+
 // Add the potion amount to all the stats
 bool Potion::use_internal(InputType type, int x, int y, World &world) {
     // Add the potion amount to the player, but only if the left mouse
     // button wqs pressed (not held, and not the right button).
     if (type == InputType::LEFT_BUTTON_PRESSED) {
-        world.player.health.addPart(woundsCured);
-        world.player.fullness.addPart(hungerCured);
-        world.player.mana.addPart(manaCured);
-        world.player.health.addFull(healthGained);
-        world.player.fullness.addFull(fullnessGained);
-        world.player.mana.addFull(manaGained);
+        world.player.health.addPart(potion.woundsCured);
+        world.player.fullness.addPart(potion.hungerCured);
+        world.player.mana.addPart(potion.manaCured);
+        world.player.health.addFull(potion.healthGained);
+        world.player.fullness.addFull(potion.fullnessGained);
+        world.player.mana.addFull(potion.manaGained);
         return true;
     }
     return false;
 }
 
 
-// Block constructor
-Block::Block(ActionType type, string path) : Item(type, path) {
+// Block prototype constructor
+BlockPrototype::BlockPrototype(ActionType type, const string &path)
+        : ItemPrototype(type, path) {
     /* Make sure we should actually be a block. */
     assert(ActionType::FIRST_BLOCK <= type);
     assert(type <= ActionType::LAST_BLOCK);
 
     /* Read in the json. */
-    std::string filename = path + Item::getJsonFilename(type);
-    std::ifstream infile(filename);
-    /* Check that the file could be opened. */
-    if (!infile) {
-        cerr << "Can't open " << filename << "\n";
-    }
-    json j = json::parse(infile);
+    const json &j = AssetBundle::getJson(path + Item::getJsonFilename(type));
 
     /* Set values. */
     bonusReach = j["bonusReach"];
@@ -80,6 +86,14 @@ Block::Block(ActionType type, string path) : Item(type, path) {
     }
 }
 
+Item *BlockPrototype::makeItem() const {
+    return new Block(*this);
+}
+
+// Block constructor
+Block::Block(const BlockPrototype &prototype) : Item(prototype),
+        block(prototype) {}
+
 /* Destructor must be virtual. */
 Block::~Block() {};
 
@@ -99,7 +113,8 @@ bool Block::canPlace(int x, int y, const Player &player, const Map &map) {
     /* And now we have our answer. We don't need to do anything special about 
     wrapping the map because xTile will already be outside of the map range if 
     that's needed to get it numerically closer to the player. */
-    return player.canReach(xTile - xPlayer, yTile - yPlayer, bonusReach); 
+    return player.canReach(xTile - xPlayer, yTile - yPlayer, 
+        block.bonusReach); 
 }
 
 MapLayer Block::getLayer(InputType type) {
@@ -136,26 +151,29 @@ bool Block::use_internal(InputType type, int x, int y, World &world) {
     /* If success is still false at the end, don't set the player's use
     time left. */
     bool success = world.map.placeTile(
-            world.map.getMapCoords(x, y, layer), tileType);
+            world.map.getMapCoords(x, y, layer), block.tileType);
 
     return success;
 }
 
-/* Pickaxe constructor. */
-Pickaxe::Pickaxe(ActionType type, string path) : Block(type, path) {
+/* Pickaxe prototype constructor. */
+PickaxePrototype::PickaxePrototype(ActionType type, const string &path)
+        : BlockPrototype(type, path) {
     /* Load the right json based on the type. */
-    std::string filename = path + Item::getJsonFilename(type);
-    std::ifstream infile(filename);
-    /* Check that the file could be opened. */
-    if (!infile) {
-        cerr << "Can't open " << filename << "\n";
-    }
-    json j = json::parse(infile);
+    const json &j = AssetBundle::getJson(path + Item::getJsonFilename(type));
 
     blockDamage = j["blockDamage"];
     tier = j["tier"];
 }
 
+Item *PickaxePrototype::makeItem() const {
+    return new Pickaxe(*this);
+}
+
+/* Pickaxe constructor. */
+Pickaxe::Pickaxe(const PickaxePrototype &prototype) : Block(prototype),
+        pickaxe(prototype) {}
+
 /* Pickaxe use. */
 bool Pickaxe::use_internal(InputType type, int x, int y, World &world) {
     // Only do anything if the tile is within range
@@ -167,11 +185,12 @@ bool Pickaxe::use_internal(InputType type, int x, int y, World &world) {
     MapLayer layer = getLayer(type);
     Location place = world.map.getMapCoords(x, y, layer);
     /* Only mine blocks this pickaxe is capable of mining. */
-    if (world.map.getTile(place) -> getTier() > tier) {
+    if (world.map.getTile(place) -> getTier() > pickaxe.tier) {
         return false;
     }
 
-    bool success = world.map.damage(place, blockDamage, world.droppedItems);
+    bool success = world.map.damage(place, pickaxe.blockDamage, 
+        world.droppedItems);
     return success;
 }
 
@@ -231,28 +250,52 @@ bool ItemMaker::isIn(std::vector<ActionType> items, ActionType type) {
     return false;
 }
 
-// Take an item type and make the correct child class based on that
-Item *ItemMaker::makeItem(ActionType type, string path) {
+// Take an item type and make the prototype of the correct child class
+static ItemPrototype *newPrototype(ActionType type, const string &path) {
     // A list of all the item types that should be potions
     std::vector<ActionType> potions;
     potions.push_back(ActionType::HEALTH_POTION);
 
     // If it's a potion, make a potion
-    if (isIn(potions, type)) {
-        return new Potion(type, path);
+    if (ItemMaker::isIn(potions, type)) {
+        return new PotionPrototype(type, path);
     }
     // If it's a block, make a block
     else if ((int)ActionType::FIRST_BLOCK <= (int)type
                 && (int)type <= (int)ActionType::LAST_PURE_BLOCK) {
-        return new Block(type, path);
+        return new BlockPrototype(type, path);
     }
     /* If it's a pickaxe, make a pickaxe. */
     else if (type == ActionType::PICKAXE) {
-        return new Pickaxe(type, path);
+        return new PickaxePrototype(type, path);
     }
     // If it's not a subclass of item, than it's a plain old item
     else {
-        return new Item(type, path);
+        return new ItemPrototype(type, path);
+    }
+}
+
+const ItemPrototype &ItemMaker::getPrototype(ActionType type, 
+        const string &path) {
+    assert((int)ActionType::FIRST_ITEM <= (int)type);
+    assert((int)type <= (int)ActionType::LAST_ITEM);
+    lock_guard<mutex> lock(prototypesMutex);
+    if (!prototypes[(int)type]) {
+        prototypes[(int)type] = newPrototype(type, path);
+    }
+    return *prototypes[(int)type];
+}
+
+void ItemMaker::clearPrototypes() {
+    lock_guard<mutex> lock(prototypesMutex);
+    for (unsigned int i = 0; i < prototypes.size(); i++) {
+        delete prototypes[i];
+        prototypes[i] = nullptr;
     }
 }
 
+// Take an item type and make the correct child class based on that
+Item *ItemMaker::makeItem(ActionType type, string path) {
+    return getPrototype(type, path).makeItem();
+}
+
@@ -10,9 +10,9 @@ class Player;
 class Map;
 
 
-// All the child classes of "Item"
-// Items that change the player's stats
-class Potion : public Item {
+// All the child classes of "Item", and their prototypes
+// What every potion of a type does
+struct PotionPrototype : public ItemPrototype {
     int healthGained;
     int fullnessGained;
     int manaGained;
@@ -20,22 +20,43 @@ class Potion : public Item {
     int hungerCured; // Removes the completely empty part of fullness
     int manaCured; // Removed the completely empty part of mana
 
+    // Constructor
+    PotionPrototype(ActionType type, const std::string &path);
+
+    virtual Item *makeItem() const;
+};
+
+// Items that change the player's stats
+class Potion : public Item {
+    const PotionPrototype &potion;
+
 public:
     // Constructor
-    Potion(ActionType type, std::string path);
+    Potion(const PotionPrototype &prototype);
 
     // What to do when used
     virtual bool use_internal(InputType type, int x, int y, World &world);
 };
 
-// Items that can be placed
-class Block : public Item {
+// What every block of a type does
+struct BlockPrototype : public ItemPrototype {
     /* The type of the associated tile. */
     TileType tileType;
-protected:
+
     /* For blocks that let the player place them extra far away. */
     int bonusReach;
 
+    // Constructor
+    BlockPrototype(ActionType type, const std::string &path);
+
+    virtual Item *makeItem() const;
+};
+
+// Items that can be placed
+class Block : public Item {
+protected:
+    const BlockPrototype &block;
+
     /* Tell whether the player can reach far enough to place a block here. */
     bool canPlace(int x, int y, const Player &player, const Map &map);
 
@@ -45,7 +66,7 @@ protected:
 
 public:
     // Constructor
-    Block(ActionType type, std::string path);
+    Block(const BlockPrototype &prototype);
 
     /* Destructor must be virtual. */
     virtual ~Block();
@@ -54,13 +75,23 @@ public:
     virtual bool use_internal(InputType type, int x, int y, World &world);
 };
 
-/* Items that can damage blocks. */
-class Pickaxe: public Block {
+/* What every pickaxe of a type does. */
+struct PickaxePrototype : public BlockPrototype {
     int blockDamage;
     int tier;
+
+    /* Constructor. */
+    PickaxePrototype(ActionType type, const std::string &path);
+
+    virtual Item *makeItem() const;
+};
+
+/* Items that can damage blocks. */
+class Pickaxe: public Block {
+    const PickaxePrototype &pickaxe;
 public:
     /* Constructor. */
-    Pickaxe(ActionType type, std::string path);
+    Pickaxe(const PickaxePrototype &prototype);
 
     /* What to do when used. */
     virtual bool use_internal(InputType type, int x, int y, World &world);
@@ -80,6 +111,14 @@ namespace ItemMaker {
     // Whether the type is in the vector
     bool isIn(std::vector<ActionType> items, ActionType type);
 
+    /* Get the prototype every item of a type shares, making it the first
+    time it's asked for. */
+    const ItemPrototype &getPrototype(ActionType type, const std::string &path);
+
+    /* Delete every prototype. Items made from them can't be used after
+    this. */
+    void clearPrototypes();
+
     // Take an item type and make the correct child class based on that
     Item *makeItem(ActionType type, std::string path);
 }
@@ -0,0 +1,176 @@
+#include "AssetBundle.hh"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <dirent.h>
+#include <sys/stat.h>
+
+using json = nlohmann::json;
+using namespace std;
+
+/* Declare static variables. */
+std::mutex AssetBundle::m;
+std::unordered_map<std::string, json> AssetBundle::definitions;
+const std::vector<std::string> AssetBundle::folders = {"tiles/", "items/",
+    "entities/"};
+
+vector<string> AssetBundle::listFiles(const string &path) {
+    vector<string> answer;
+    for (unsigned int i = 0; i < folders.size(); i++) {
+        DIR *dir = opendir((path + folders[i]).c_str());
+        if (!dir) {
+            cerr << "Can't open " << path + folders[i] << "\n";
+            continue;
+        }
+        struct dirent *entry;
+        while ((entry = readdir(dir))) {
+            string name = entry->d_name;
+            string suffix = ".json";
+            if (name.size() > suffix.size() && name.compare(
+                    name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                answer.push_back(folders[i] + name);
+            }
+        }
+        closedir(dir);
+    }
+    sort(answer.begin(), answer.end());
+    return answer;
+}
+
+bool AssetBundle::getStamp(const string &filename, int64_t &size,
+        int64_t &modified) {
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) {
+        return false;
+    }
+    size = info.st_size;
+    modified = (int64_t)info.st_mtim.tv_sec * 1000000000
+        + info.st_mtim.tv_nsec;
+    return true;
+}
+
+bool AssetBundle::loadBundle(const string &path) {
+    ifstream infile(path + ASSET_BUNDLE_FILE, ios::binary);
+    if (!infile) {
+        return false;
+    }
+    vector<uint8_t> bytes((istreambuf_iterator<char>(infile)),
+        istreambuf_iterator<char>());
+
+    json bundle;
+    try {
+        bundle = json::from_cbor(bytes);
+    }
+    catch (const std::exception &e) {
+        cerr << "Ignoring broken asset bundle: " << e.what() << "\n";
+        return false;
+    }
+    if (!bundle.is_object() || bundle.count("version") == 0
+            || bundle["version"] != ASSET_BUNDLE_VERSION
+            || !bundle["files"].is_array()) {
+        return false;
+    }
+
+    /* Every file has to be there with the same size and modification time
+    it had when the bundle was made, and there can't be any new ones. */
+    const json &files = bundle["files"];
+    vector<string> names = listFiles(path);
+    if (names.size() != files.size()) {
+        return false;
+    }
+    for (unsigned int i = 0; i < names.size(); i++) {
+        int64_t size;
+        int64_t modified;
+        if (!getStamp(path + names[i], size, modified)
+                || files[i]["name"] != names[i]
+                || files[i]["size"] != size
+                || files[i]["modified"] != modified) {
+            return false;
+        }
+    }
+
+    lock_guard<mutex> lock(m);
+    for (unsigned int i = 0; i < names.size(); i++) {
+        if (!files[i]["data"].is_null()) {
+            definitions[path + names[i]] = files[i]["data"];
+        }
+    }
+    return true;
+}
+
+void AssetBundle::build(const string &path) {
+    json files = json::array();
+    vector<string> names = listFiles(path);
+    for (unsigned int i = 0; i < names.size(); i++) {
+        int64_t size = 0;
+        int64_t modified = 0;
+        getStamp(path + names[i], size, modified);
+        /* A broken file is left out, so whatever uses it gets the same
+        error it would have without the bundle. */
+        json data;
+        try {
+            data = parseFile(path + names[i]);
+        }
+        catch (const std::invalid_argument &e) {
+            cerr << "Can't parse " << path + names[i] << ": " << e.what()
+                << "\n";
+        }
+        files.push_back({{"name", names[i]}, {"size", size},
+            {"modified", modified}, {"data", data}});
+        if (!data.is_null()) {
+            lock_guard<mutex> lock(m);
+            definitions[path + names[i]] = data;
+        }
+    }
+
+    json bundle = {{"version", ASSET_BUNDLE_VERSION}, {"files", files}};
+    vector<uint8_t> bytes = json::to_cbor(bundle);
+    /* Write to a temporary file first so a half-written bundle never gets
+    read. Failing isn't a big deal; everything is already loaded and the
+    game just has to parse the json again next time. */
+    string filename = path + ASSET_BUNDLE_FILE;
+    ofstream outfile(filename + ".tmp", ios::binary | ios::trunc);
+    outfile.write((const char *)bytes.data(), bytes.size());
+    outfile.close();
+    if (!outfile || rename((filename + ".tmp").c_str(),
+            filename.c_str()) != 0) {
+        cerr << "Can't write " << filename << "\n";
+        remove((filename + ".tmp").c_str());
+    }
+}
+
+json AssetBundle::parseFile(const string &filename) {
+    ifstream infile(filename);
+    /* Check that file was opened successfully. */
+    if (!infile) {
+        cerr << "Can't open " << filename << "\n";
+    }
+    return json::parse(infile);
+}
+
+void AssetBundle::load(const string &path) {
+    if (!loadBundle(path)) {
+        build(path);
+    }
+}
+
+const json &AssetBundle::getJson(const string &filename) {
+    {
+        lock_guard<mutex> lock(m);
+        auto found = definitions.find(filename);
+        if (found != definitions.end()) {
+            return found->second;
+        }
+    }
+    /* Parse it without holding the lock, since that's the slow part. If
+    another thread got there first, emplace keeps theirs. */
+    json data = parseFile(filename);
+    lock_guard<mutex> lock(m);
+    return definitions.emplace(filename, std::move(data)).first->second;
+}
+
+void AssetBundle::clear() {
+    lock_guard<mutex> lock(m);
+    definitions.clear();
+}
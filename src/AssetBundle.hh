@@ -0,0 +1,67 @@
+#ifndef ASSETBUNDLE_HH
+#define ASSETBUNDLE_HH
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include "json.hh"
+
+/* The file all the json definitions get packed into. */
+#define ASSET_BUNDLE_FILE "assets.bundle"
+
+/* Increase this whenever the layout of the bundle changes. */
+#define ASSET_BUNDLE_VERSION 1
+
+/* Keeps every parsed json definition in memory so that making a tile, item,
+or entity doesn't have to open and parse its file again.
+
+At startup, load() reads the bundle, which has the contents of every file in
+tiles/, items/, and entities/ stored as CBOR along with the size and
+modification time each file had when the bundle was made. If any of those
+files changed, or files were added or removed, the bundle is stale, so the
+json files get parsed instead and a fresh bundle is written. */
+class AssetBundle {
+    /* For multithreaded access, since the map generator makes tiles on a
+    different thread. */
+    static std::mutex m;
+
+    /* Parsed json, by the full filename it was (or would be) read from. */
+    static std::unordered_map<std::string, nlohmann::json> definitions;
+
+    /* The folders the bundle holds the json files of. */
+    static const std::vector<std::string> folders;
+
+    /* Return the sorted names, relative to path, of every json file in the
+    bundled folders. */
+    static std::vector<std::string> listFiles(const std::string &path);
+
+    /* Get the size and modification time of a file. Return false if it
+    can't be found. */
+    static bool getStamp(const std::string &filename, int64_t &size,
+        int64_t &modified);
+
+    /* Read the bundle into definitions. Return false if it's missing, from
+    a different version, or stale. */
+    static bool loadBundle(const std::string &path);
+
+    /* Parse every json file and write a fresh bundle. */
+    static void build(const std::string &path);
+
+    /* Open and parse one json file. */
+    static nlohmann::json parseFile(const std::string &filename);
+
+public:
+    /* Load the bundle in path, rebuilding it first if it's stale. */
+    static void load(const std::string &path);
+
+    /* Get the parsed contents of a json file. If it isn't in memory yet, it
+    gets parsed and kept. The reference stays valid until clear() is
+    called. */
+    static const nlohmann::json &getJson(const std::string &filename);
+
+    /* Forget everything that was loaded. */
+    static void clear();
+};
+
+#endif
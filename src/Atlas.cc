@@ -0,0 +1,129 @@
+#include "Atlas.hh"
+#include <iostream>
+#include <algorithm>
+#include <dirent.h>
+#include <SDL2/SDL_image.h>
+
+/* Empty pixels between pictures, so that nothing drawn from one picture can
+pick up the edge of the one next to it. */
+#define ATLAS_PADDING 1
+
+using namespace std;
+
+/* Declare static variables. */
+std::mutex Atlas::m;
+std::shared_ptr<Texture> Atlas::texture;
+std::unordered_map<std::string, SDL_Rect> Atlas::places;
+
+void Atlas::build(const string &folder) {
+    /* Load every picture. */
+    vector<string> names;
+    vector<SDL_Surface *> surfaces;
+    DIR *dir = opendir(folder.c_str());
+    if (!dir) {
+        cerr << "Can't open " << folder << "\n";
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        string name = entry->d_name;
+        string suffix = ".png";
+        if (name.size() > suffix.size() && name.compare(
+                name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            names.push_back(folder + name);
+        }
+    }
+    closedir(dir);
+    sort(names.begin(), names.end());
+    for (unsigned int i = 0; i < names.size(); i++) {
+        surfaces.push_back(IMG_Load(names[i].c_str()));
+        if (!surfaces.back()) {
+            cerr << "Failed to load image with filename " << names[i]
+                << "\nSDL_Error: " << SDL_GetError() << "\n";
+        }
+    }
+
+    /* Put them in rows, tallest first, so that each row wastes as little
+    space as possible. */
+    vector<int> order;
+    for (unsigned int i = 0; i < surfaces.size(); i++) {
+        if (surfaces[i]) {
+            order.push_back(i);
+        }
+    }
+    stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return surfaces[a] -> h > surfaces[b] -> h;
+    });
+    unordered_map<string, SDL_Rect> newPlaces;
+    int x = 0;
+    int y = 0;
+    int rowHeight = 0;
+    for (unsigned int i = 0; i < order.size(); i++) {
+        SDL_Surface *surface = surfaces[order[i]];
+        if (x + surface -> w > ATLAS_WIDTH) {
+            x = 0;
+            y += rowHeight + ATLAS_PADDING;
+            rowHeight = 0;
+        }
+        if (surface -> w > ATLAS_WIDTH
+                || y + surface -> h > ATLAS_MAX_HEIGHT) {
+            cerr << names[order[i]] << " doesn't fit in the atlas\n";
+            continue;
+        }
+        newPlaces[names[order[i]]] = {x, y, surface -> w, surface -> h};
+        x += surface -> w + ATLAS_PADDING;
+        rowHeight = max(rowHeight, surface -> h);
+    }
+
+    /* Copy them all into one picture, and make that a texture. */
+    shared_ptr<Texture> newTexture;
+    if (!newPlaces.empty()) {
+        SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_WIDTH,
+            y + rowHeight, 32, SDL_PIXELFORMAT_RGBA32);
+        if (atlas) {
+            for (unsigned int i = 0; i < surfaces.size(); i++) {
+                auto found = newPlaces.find(names[i]);
+                if (found != newPlaces.end()) {
+                    /* Copy the alpha too instead of blending with it. */
+                    SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+                    SDL_Rect rectTo = found->second;
+                    SDL_BlitSurface(surfaces[i], nullptr, atlas, &rectTo);
+                }
+            }
+            newTexture.reset(new Texture(atlas));
+            SDL_FreeSurface(atlas);
+        }
+        if (!newTexture || !newTexture -> hasTexture()) {
+            cerr << "Can't make the atlas, so every picture in " << folder
+                << " gets its own texture.\nSDL_Error: " << SDL_GetError()
+                << "\n";
+            newTexture = nullptr;
+            newPlaces.clear();
+        }
+    }
+    for (unsigned int i = 0; i < surfaces.size(); i++) {
+        SDL_FreeSurface(surfaces[i]);
+    }
+
+    lock_guard<mutex> lock(m);
+    texture = newTexture;
+    places = newPlaces;
+}
+
+bool Atlas::find(const string &filename, shared_ptr<Texture> &atlas,
+        SDL_Rect &place) {
+    lock_guard<mutex> lock(m);
+    auto found = places.find(filename);
+    if (found == places.end()) {
+        return false;
+    }
+    atlas = texture;
+    place = found->second;
+    return true;
+}
+
+void Atlas::clear() {
+    lock_guard<mutex> lock(m);
+    texture = nullptr;
+    places.clear();
+}
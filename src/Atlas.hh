@@ -0,0 +1,47 @@
+#ifndef ATLAS_HH
+#define ATLAS_HH
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <SDL2/SDL.h>
+#include "Texture.hh"
+
+/* How wide the atlas is, and how tall it's allowed to get. Every renderer
+SDL supports can handle textures this big. */
+#define ATLAS_WIDTH 2048
+#define ATLAS_MAX_HEIGHT 2048
+
+/* Every picture in a folder packed into one texture at startup, so that
+things drawn from different pictures can all be drawn together. Pictures
+that don't fit are left out, and whatever uses them loads them on their own
+like before. */
+class Atlas {
+    /* For multithreaded access, since tiles can be made on any thread. */
+    static std::mutex m;
+
+    /* The texture everything was packed into, or nullptr if there isn't
+    one. */
+    static std::shared_ptr<Texture> texture;
+
+    /* Where in the texture each picture is, by filename. */
+    static std::unordered_map<std::string, SDL_Rect> places;
+
+public:
+    /* Pack every png in folder into the atlas, replacing whatever it had. */
+    static void build(const std::string &folder);
+
+    /* If the picture with this filename is in the atlas, set atlas to the
+    atlas's texture and place to where the picture is in it, and return
+    true. Otherwise return false. */
+    static bool find(const std::string &filename,
+        std::shared_ptr<Texture> &atlas, SDL_Rect &place);
+
+    /* Let go of the texture. This has to happen before the renderer is
+    destroyed. */
+    static void clear();
+};
+
+#endif
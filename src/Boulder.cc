@@ -6,6 +6,7 @@
 #include "MapHelpers.hh"
 #include "Rect.hh"
 #include "json.hh"
+#include "AssetBundle.hh"
 #include "DroppedItem.hh"
 
 #define BOULDER_CARRY_HEIGHT 1.5
@@ -96,16 +97,8 @@ bool Boulder::canUpdate(const Map &map, const Location &place,
 
 /* Constructor. */
 Boulder::Boulder(TileType type, string path) : Tile(type, path) {
-    /* The name of the file where the initial values are stored. */
-    std::string filename = path + getFilename(type);
-
-    /* Put data in a json. */
-    std::ifstream infile(filename);
-    /* Check that file was opened successfully. */
-    if (!infile) {
-        cerr << "Can't open " << filename << "\n";
-    }
-    json j = json::parse(infile);
+    /* The same json the tile values came from. */
+    const json &j = AssetBundle::getJson(path + getFilename(type));
 
     /* Set the boulder's values to the json values. (The tile-but-not-boulder
     values should have already been set.) */
@@ -127,8 +120,8 @@ void Boulder::setDirection(Map &map, const Location &place, int direction)
     direction = (direction + 1) / 2;
     Location spritePlace = map.getSprite(place);
     /* If direction = 1, spritePlace.y should be at least sprite.cols / 4. */
-    spritePlace.x %= sprite.getCols() / 4;
-    spritePlace.x += direction * (sprite.getCols() / 4);
+    spritePlace.x %= getSheetCols() / 4;
+    spritePlace.x += direction * (getSheetCols() / 4);
     map.setSprite(place, spritePlace); 
 }
 
@@ -165,6 +158,6 @@ int Boulder::getDirection(const Map &map, const Location &place) const {
         return 0; 
     }
     Location spritePlace = map.getSprite(place);
-    return (spritePlace.x < sprite.getCols() / 4) ? -1 : 1;
+    return (spritePlace.x < getSheetCols() / 4) ? -1 : 1;
 }
 
@@ -6,8 +6,8 @@ DroppedItem::DroppedItem(Item *i, int x, int y, int worldWidth) {
     item = i;
     setX(x);
     setY(y);
-    rect.w = i->sprite.getWidth();
-    rect.h = i->sprite.getHeight();
+    rect.w = i->getSprite().getWidth();
+    rect.h = i->getSprite().getHeight();
     rect.worldWidth = worldWidth;
     nextRect = rect;
     nextRect.x = 0;
@@ -23,16 +23,24 @@ DroppedItem::~DroppedItem() {
     delete item;
 }
 
-void DroppedItem::render(const Rect &camera) {
+Light DroppedItem::getEmitted() const {
+    if (!item) {
+        return Light();
+    }
+    return item -> getEmitted();
+}
+
+void DroppedItem::render(const Rect &camera, double alpha) {
     if (!item) {
         return;
     }
     // Make sure the renderer draw color is set to white
     Renderer::setColorWhite();
 
-    SDL_Rect to = {rect.x, rect.y, rect.w, rect.h};
+    Rect drawRect = getRenderRect(alpha);
+    SDL_Rect to = {drawRect.x, drawRect.y, drawRect.w, drawRect.h};
     convertRect(to, camera);
-    item -> sprite.render(to);
+    item -> getSprite().render(to);
 }
 
 void DroppedItem::merge(DroppedItem *dropped) {
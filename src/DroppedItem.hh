@@ -28,7 +28,10 @@ public:
     ~DroppedItem();
 
     /* Render itself. */
-    virtual void render(const Rect &camera);
+    virtual void render(const Rect &camera, double alpha);
+
+    /* Give off the light its item does. */
+    virtual Light getEmitted() const;
 
     /* Merge with another stack. */
     void merge(DroppedItem *item);
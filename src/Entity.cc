@@ -1,6 +1,7 @@
 #include "Entity.hh"
 #include "filepaths.hh"
 #include "DroppedItem.hh"
+#include "AssetBundle.hh"
 
 using json = nlohmann::json;
 using namespace std;
@@ -8,10 +9,7 @@ using namespace std;
 // Constructor
 Entity::Entity(std::string filename, std::string path) 
         : movable::Movable(filename) {
-    /* Open the json file. */
-    std::ifstream infile(filename);
-    /* Put data in json. */
-    json j = json::parse(infile);
+    const json &j = AssetBundle::getJson(filename);
     maxFallDistance = j["maxFallDistance"];
     health = j["health"].get<Stat>();
     fullness = j["fullness"].get<Stat>();
@@ -103,13 +101,14 @@ void Entity::update(vector<DroppedItem*> &drops) {
     }
 }
 
-void Entity::render(const Rect &camera) {
+void Entity::render(const Rect &camera, double alpha) {
     // Make sure the renderer draw color is set to white
     Renderer::setColorWhite();
 
+    Rect drawRect = getRenderRect(alpha);
     SDL_Rect rectTo;
-    rectTo.x = rect.x;
-    rectTo.y = rect.y;
+    rectTo.x = drawRect.x;
+    rectTo.y = drawRect.y;
 
     /* Which sprite to draw. */
     SpriteBase *drawSprite = nullptr;
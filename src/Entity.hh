@@ -62,7 +62,7 @@ public:
     virtual void update(std::vector<DroppedItem*> &drops);
 
     /* Render the correct sprite / animation. */
-    virtual void render(const Rect &camera);
+    virtual void render(const Rect &camera, double alpha);
 
     /* Attempt to pick up an item. */
     virtual void pickup(DroppedItem *item);
@@ -1,5 +1,6 @@
 #include <cassert>
 #include <iostream>
+#include <thread>
 #include "EventHandler.hh"
 
 // Include things that were forward declared in the header
@@ -140,6 +141,12 @@ EventHandler::EventHandler() {
     keySettings.inventoryKeys.push_back(SDL_SCANCODE_C);
     /* Keys to toss items. */
     keySettings.tossKeys.push_back(SDL_SCANCODE_T);
+    /* Key to switch how many threads lighting uses. */
+    keySettings.lightingThreadKeys.push_back(SDL_SCANCODE_K);
+    /* Key to switch whether light is smoothed between tiles. */
+    keySettings.smoothLightKeys.push_back(SDL_SCANCODE_L);
+    /* Key to switch how often the screen is drawn. */
+    keySettings.frameRateKeys.push_back(SDL_SCANCODE_V);
     // And each of 24 keys to select a hotbar slot
     keySettings.hotbarKeys.push_back(SDL_SCANCODE_1);
     keySettings.hotbarKeys.push_back(SDL_SCANCODE_2);
@@ -275,8 +282,10 @@ void EventHandler::useMouse(Player &player, World &world) {
 }
 
 // Do whatever should be done when key presses or releases happen
-void EventHandler::keyEvent(const SDL_Event &event, Player &player, 
-        vector<DroppedItem *> &drops) { 
+void EventHandler::keyEvent(const SDL_Event &event, World &world,
+        WindowHandler &window) { 
+    Player &player = world.player;
+    vector<DroppedItem *> &drops = world.droppedItems;
     SDL_Scancode key = event.key.keysym.scancode;
 
     // Here we should handle keys which don't need to be held down to work.
@@ -289,6 +298,29 @@ void EventHandler::keyEvent(const SDL_Event &event, Player &player,
     else if (isIn(key, keySettings.tossKeys)) {
         player.toss(drops);
     }
+    else if (isIn(key, keySettings.lightingThreadKeys)) {
+        int threads = 1;
+        if (world.map.getLightThreads() == 1) {
+            threads = thread::hardware_concurrency();
+        }
+        world.map.setLightThreads(threads);
+    }
+    else if (isIn(key, keySettings.smoothLightKeys)) {
+        window.setSmoothLight(!window.getSmoothLight());
+    }
+    else if (isIn(key, keySettings.frameRateKeys)) {
+        switch (window.getFrameRate()) {
+            case FrameRate::CAPPED:
+                window.setFrameRate(FrameRate::UNCAPPED);
+                break;
+            case FrameRate::UNCAPPED:
+                window.setFrameRate(FrameRate::VSYNC);
+                break;
+            case FrameRate::VSYNC:
+                window.setFrameRate(FrameRate::CAPPED);
+                break;
+        }
+    }
     else if (isIn(key, keySettings.hotbarKeys)) {
         // Select the appropriate slot in the hotbar
         // This vector actually has the order matter, so you can't map more
@@ -29,6 +29,15 @@ struct KeySettings {
 
     /* Keys to toss items onto the ground. */
     std::vector<SDL_Scancode> tossKeys;
+
+    /* Keys to switch between lighting on one thread and on all of them. */
+    std::vector<SDL_Scancode> lightingThreadKeys;
+
+    /* Keys to switch between smooth lighting and one light per tile. */
+    std::vector<SDL_Scancode> smoothLightKeys;
+
+    /* Keys to go through capped, uncapped, and vsynced frame rates. */
+    std::vector<SDL_Scancode> frameRateKeys;
 };
 
 /* A class to handle events such as keyboard input or mouse movement. */
@@ -95,8 +104,8 @@ public:
     void useMouse(Player &player, World &world);
 
     // Do whatever should be done when a key is pressed or released
-    void keyEvent(const SDL_Event &event, Player &player, 
-        std::vector<DroppedItem *> &drops);
+    void keyEvent(const SDL_Event &event, World &world, 
+        WindowHandler &window);
 
     // Do stuff for keys being held down
     void updateKeys(const Uint8 *state);
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <cassert>
+#include <thread>
 #include "Tile.hh"
 #include "Mapgen.hh"
 #include "EventHandler.hh"
@@ -10,6 +11,8 @@
 #include "Hotbar.hh"
 #include "Menu.hh"
 #include "World.hh"
+#include "AssetBundle.hh"
+#include "Atlas.hh"
 
 using namespace std;
 
@@ -24,38 +27,63 @@ bool Game::play(string mapname) {
     world = new World(path + mapname, TILE_WIDTH, TILE_HEIGHT, path);
 
     window.setMapSize(world -> map.getWidth(), world -> map.getHeight());
+    /* Light the screen using every core. K switches to just this thread. */
+    world -> map.setLightThreads(thread::hardware_concurrency());
 
-    /* Frames since the start of the world. */
+    /* Updates since the start of the world. */
     uint32_t gameTicks = 0;
 
+    /* How many milliseconds of game time haven't been updated yet. Start 
+    with one update's worth so there's something to draw. */
+    double lag = TICKS_PER_FRAME;
+    Uint64 lastCount = SDL_GetPerformanceCounter();
+
     /* Loop infinitely until exiting. */
     bool quit = false;
     while (!quit) {
-        Uint32 ticks = SDL_GetTicks();
+        Uint64 count = SDL_GetPerformanceCounter();
+        lag += (double)(count - lastCount) * 1000 
+            / SDL_GetPerformanceFrequency();
+        lastCount = count;
+        /* If updating is too slow to keep up, slow the game down instead
+        of falling further behind every frame. */
+        lag = min(lag, (double)(MAX_CATCH_UP * TICKS_PER_FRAME));
+
         /* Handle events on the queue. */
         quit = update();
 
-        /* Now that all the events have been handled, do eventhandling things 
-        that need to be done every update (like checking whether any keys
-        or mouse buttons are being held down). */
-        eventHandler.update(*world);
+        /* Update the world at a fixed rate, however often it's drawn. */
+        while (lag >= TICKS_PER_FRAME) {
+            /* Now that all the events have been handled, do eventhandling
+            things that need to be done every update (like checking whether
+            any keys or mouse buttons are being held down). */
+            eventHandler.update(*world);
 
-        world -> update();
+            world -> update();
+            lag -= TICKS_PER_FRAME;
 
-        /* Put pictures on the screen, but only if rendering isn't really 
-        slow. */
-        uint32_t frameTicks = SDL_GetTicks() - ticks;
-        if (frameTicks < 2 * TICKS_PER_FRAME) { 
-            window.update(*world);
-        }
+            /* Count the number of times the world has updated. */
+            gameTicks++;
 
-        /* Count the number of times we've gone through this loop. */
-        gameTicks++;
+            /* Save whatever has changed every so often, in case of 
+            crashes. */
+            if (gameTicks % AUTOSAVE_FRAMES == 0) {
+                world -> map.autosave(path + mapname);
+            }
+        }
 
-        /* Wait for enough time to pass before doing the next frame. */
-        frameTicks = SDL_GetTicks() - ticks;
-        if (frameTicks < TICKS_PER_FRAME) {
-            SDL_Delay(TICKS_PER_FRAME - frameTicks);
+        /* Put pictures on the screen, with things that move drawn partway
+        to where they'll be after the next update. */
+        window.update(*world, lag / TICKS_PER_FRAME);
+
+        /* When capped, wait until the next update is due before drawing
+        again. Otherwise vsync does the waiting, or nothing does. */
+        if (window.getFrameRate() == FrameRate::CAPPED) {
+            double spent = (double)(SDL_GetPerformanceCounter() - lastCount)
+                * 1000 / SDL_GetPerformanceFrequency();
+            if (lag + spent < TICKS_PER_FRAME) {
+                SDL_Delay((Uint32)(TICKS_PER_FRAME - lag - spent));
+            }
         }
     }
     world -> map.save(path + mapname);
@@ -70,6 +98,9 @@ bool Game::play(string mapname) {
 
 
 bool Game::update() {
+    /* Make whatever textures other threads are waiting for. */
+    Renderer::doQueued();
+
     SDL_Event event;
     bool quit = false;
     /* Handle events on the queue. */
@@ -87,8 +118,7 @@ bool Game::update() {
             case SDL_KEYUP:
                 if (isPlaying) {
                     assert(world);
-                    eventHandler.keyEvent(event, world -> player, 
-                        world -> droppedItems);
+                    eventHandler.keyEvent(event, *world, window);
                 }
                 break;
             case SDL_MOUSEMOTION:
@@ -107,9 +137,18 @@ bool Game::update() {
 }
 
 Game::Game(string p) : SCREEN_FPS(60), TICKS_PER_FRAME(1000 / SCREEN_FPS),
+        // Autosave every 5 seconds
+        AUTOSAVE_FRAMES(5 * SCREEN_FPS),
+        // Drop updates rather than fall more than 5 behind
+        MAX_CATCH_UP(5),
         // 800 x 600 window, resizable
         window(800, 600, TILE_WIDTH, TILE_HEIGHT) {
     path = p;
+    /* Read every tile, item, and entity definition once, up front. */
+    AssetBundle::load(path);
+    /* Pack every tile spritesheet into one texture, so a screen of tiles can
+    be drawn from just that. */
+    Atlas::build(path + TILE_SPRITE_PATH);
     isFocused = true;
     isPlaying = false;
     menu = nullptr;
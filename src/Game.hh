@@ -9,10 +9,17 @@
 class Menu;
 
 class Game { 
-    /* For capping the frame rate. */
+    /* How many times a second the world updates, and how many 
+    milliseconds each update is. */
     const uint32_t SCREEN_FPS;
     const uint32_t TICKS_PER_FRAME;
 
+    /* How many updates between autosaves. */
+    const uint32_t AUTOSAVE_FRAMES;
+
+    /* The most updates to do at once to catch up after a slow frame. */
+    const uint32_t MAX_CATCH_UP;
+
     /* The path to the folder containing the executable. */
     static std::string path;
 
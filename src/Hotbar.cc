@@ -220,7 +220,7 @@ void Hotbar::update(Action *&mouse, bool isInvOpen) {
 }
 
 // Return the selected action
-Action *Hotbar::getSelected() {
+Action *Hotbar::getSelected() const {
     // TODO
     /*
     return actions[selected].action;
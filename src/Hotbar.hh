@@ -73,7 +73,7 @@ public:
     void update(Action *&mouse, bool isInvOpen);
 
     // Return the pointer to the selected action
-    Action *getSelected();
+    Action *getSelected() const;
 
     // Draw to the screen
     void render(std::string path);
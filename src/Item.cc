@@ -2,6 +2,7 @@
 #include <vector>
 #include "Item.hh"
 #include "json.hh"
+#include "AssetBundle.hh"
 #include "filepaths.hh"
 #include "AllTheItems.hh"
 #include "Game.hh"
@@ -19,48 +20,52 @@ bool Item::use_internal(InputType type, int x, int y, World &world) {
 }
 
 // Constructor
-Item::Item(ActionType t, string path) {
-    type = t;
-    item = true;
-
-    /* Figure out which json file to use. */
-    string filename = path + getJsonFilename(type);
-
-    /* Put the data in the json. */
-    ifstream infile(filename);
-    /* Check that file was opened successfully. */
-    if (!infile) {
-        cerr << "Can't open " << filename << "\n";
-    }
-    json j = json::parse(infile);
+ItemPrototype::ItemPrototype(ActionType t, const string &path) : type(t) {
+    /* Get the data from the right json file. */
+    const json &j = AssetBundle::getJson(path + Item::getJsonFilename(type));
 
     /* Set each of the values equal to the json's values. */
     sprite = j["sprite"].get<Sprite>();
     maxStack = j["maxStack"];
     useTime = j["useTime"];
     consumable = j["consumable"];
-    stack = 1;
+    if (j.count("emitted")) {
+        emitted = j["emitted"].get<Light>();
+    }
     sprite.loadTexture(path + ICON_SPRITE_PATH);
 }
 
+ItemPrototype::~ItemPrototype() {}
+
+Item *ItemPrototype::makeItem() const {
+    return new Item(*this);
+}
+
+// Constructor
+Item::Item(const ItemPrototype &p) : prototype(p) {
+    type = prototype.type;
+    item = true;
+    stack = 1;
+}
+
 void Item::use(InputType type, int x, int y, World &world) {
     assert(stack > 0);
     bool success = use_internal(type, x, y, world);
     stack -= (int)isConsumable() * (int)success;
     // If success, add the use time.
-    world.player.useTimeLeft += (int)success * useTime;
+    world.player.useTimeLeft += (int)success * getUseTime();
 }
 
 Item::~Item() {}
 
 void Item::render(SDL_Rect &rect, std::string path) {
-    int w = sprite.getWidth();
-    int h = sprite.getHeight();
+    int w = getSprite().getWidth();
+    int h = getSprite().getHeight();
     /* Center inside given rect. */
     SDL_Rect rectTo = {rect.x + (rect.w - w) / 2, rect.y + (rect.h - h) / 2,
         w, h};
     /* Render sprite. */
-    sprite.render(rectTo);
+    getSprite().render(rectTo);
     /* Render text only if there's more than one in the stack. */
     if (getStack() != 1) {
         Texture num(to_string(getStack()), ITEMSTACK_FONT_SIZE, 0);
@@ -75,18 +80,18 @@ Item *Item::merge(Item *other, int n) {
         return nullptr;
     }
     if (!other) {
-        other = ItemMaker::makeItem(getType(), Game::getPath());
+        other = prototype.makeItem();
         other->setStack(0);
     }
     /* If they're different types, no merging can be done. */
     if (other -> getType() != getType()) {
         return other;
     }
-    assert(maxStack == other->maxStack);
+    assert(&prototype == &other->prototype);
     /* Merge in the other direction. */
     if (n < 0) {
         n = min(-1 * n, getStack());
-        n = min(n, maxStack - other->getStack());
+        n = min(n, getMaxStack() - other->getStack());
         assert(n >= 0);
         other->setStack(other->getStack() + n);
         stack -= n;
@@ -95,7 +100,7 @@ Item *Item::merge(Item *other, int n) {
     }
     /* If n is 0, merge the maximum possible amount. */
     if (n == 0) {
-        n = maxStack - getStack();
+        n = getMaxStack() - getStack();
     }
     assert(n >= 0);
     n = min(n, other -> getStack());
@@ -6,24 +6,55 @@
 
 
 
-/* The thing inventories store. */
-class Item : public Action {
-protected:
+class Item;
+
+/* Everything about an item that's the same for every item of its type. There
+is only one of these for each ActionType, which every item of that type
+shares, so making an item doesn't have to read its json or load its sprite. */
+struct ItemPrototype {
+    /* Which item it is. */
+    const ActionType type;
+
+    /* What sprite should be displayed in the hotbar or inventory. */
+    Sprite sprite;
+
     /* How many can be in a stack in the same slot. */
     int maxStack;
 
-    /* How many are in this stack. */
-    int stack;
+    /* Minimum time before another item can be used. */
+    int useTime;
 
     /* Whether it gets used up when used. */
     bool consumable;
 
+    /* The light it gives off when it's held or dropped. */
+    Light emitted;
+
+    /* Constructor, from the type's json file. */
+    ItemPrototype(ActionType type, const std::string &path);
+
+    /* Destructor must be virtual. */
+    virtual ~ItemPrototype();
+
+    /* Make a new item of this type, with a stack of 1. */
+    virtual Item *makeItem() const;
+};
+
+/* The thing inventories store. */
+class Item : public Action {
+protected:
+    /* Everything that isn't specific to this stack. */
+    const ItemPrototype &prototype;
+
+    /* How many are in this stack. */
+    int stack;
+
     /* Virtual use function. Does nothing, returns false. */
     virtual bool use_internal(InputType type, int x, int y, World &world);
 
 public:
     // Constructor
-    Item(ActionType type, std::string path);
+    Item(const ItemPrototype &prototype);
 
     /* Use function. Decreases number if consumable, and calls use_internal(). */
     void use(InputType type, int x, int y, World &world);
@@ -41,7 +72,23 @@ public:
     }
 
     inline int isConsumable() {
-        return consumable;
+        return prototype.consumable;
+    }
+
+    inline int getMaxStack() const {
+        return prototype.maxStack;
+    }
+
+    virtual int getUseTime() const {
+        return prototype.useTime;
+    }
+
+    virtual const Sprite &getSprite() const {
+        return prototype.sprite;
+    }
+
+    inline Light getEmitted() const {
+        return prototype.emitted;
     }
 
     /* Render itself. */
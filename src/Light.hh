@@ -70,6 +70,13 @@ struct Light {
         return Light(r * coef, g * coef, b * coef, a * coef);
     }
 
+    /* Return this light but with each value multiplied by fraction / 256,
+    rounded down. fraction can be at most 256. */
+    inline Light scale(unsigned int fraction) const {
+        return Light(r * fraction >> 8, g * fraction >> 8, b * fraction >> 8,
+            a * fraction >> 8);
+    }
+
     /* Sum the light provided and the light from the sky (which has the 
     skyIntensity of the light provided and the color of the skyColor). */
     inline Light useSky(const Light &skyLight) const {
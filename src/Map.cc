@@ -1,6 +1,13 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cassert>
+#include <cstdio> // For rename
+#include <cstring>
+#include <fcntl.h> // For open
+#include <sys/mman.h> // For mmap
+#include <sys/stat.h> // For fstat
+#include <unistd.h> // For close
 #include <ctime> // To seed the random number generator
 #include <cstdlib> // For randomness
 #include <math.h> // Because pi
@@ -10,12 +17,83 @@
 #include "version.hh"
 #include "DroppedItem.hh"
 #include "AllTheItems.hh"
+#include "MapFile.hh"
 #include <queue>
 
-#define MAX_LIGHT_DEPTH 5
-
 using namespace std;
 
+const vector<uint16_t> Map::falloff = Map::makeFalloff();
+
+vector<uint16_t> Map::makeFalloff() {
+    /* Light falls off like a bell curve. Rounding to the nearest 256th
+    means scaling by it is never more than 1 away from multiplying by the
+    exact amount. */
+    vector<uint16_t> table(MAX_OPACITY + 1);
+    for (int n = 0; n < MAX_OPACITY; n++) {
+        double coef = exp(-1 * n * n / (MAX_OPACITY * MAX_OPACITY / 4.0));
+        table[n] = lround(min(1.0, max(coef, 0.0)) * 256);
+    }
+    /* Light that's had this much absorbed is gone. */
+    table[MAX_OPACITY] = 0;
+    return table;
+}
+
+/* Pack how much of each channel of light is absorbed into one number, the
+way ALL_OPAQUE is. */
+static uint32_t packOpacity(double r, double g, double b, double a) {
+    uint32_t packed = 0;
+    double channels[4] = {r, g, b, a};
+    for (int i = 0; i < 4; i++) {
+        int opacity = min(max((int)channels[i], 0), MAX_OPACITY);
+        packed |= (uint32_t)opacity << (8 * i);
+    }
+    return packed;
+}
+
+/* Return a mask with every bit set in each byte where a's channel is at 
+least b's. Every channel of both has to be less than 128. */
+static inline uint32_t atLeast(uint32_t a, uint32_t b) {
+    /* Subtracting from a byte with its high bit set doesn't borrow from the
+    next byte, and leaves the high bit set only if a's channel was at least
+    as big. */
+    uint32_t high = ((a | 0x80808080u) - b) & 0x80808080u;
+    return (high >> 7) * 0xFF;
+}
+
+/* Return the smaller of each channel of two packed opacities. */
+static inline uint32_t minOpacity(uint32_t a, uint32_t b) {
+    uint32_t mask = atLeast(a, b);
+    return (b & mask) | (a & ~mask);
+}
+
+/* Return the bigger of each channel of two packed opacities. */
+static inline uint32_t maxOpacity(uint32_t a, uint32_t b) {
+    uint32_t mask = atLeast(a, b);
+    return (a & mask) | (b & ~mask);
+}
+
+/* Return the sum of each channel of two packed opacities, with nothing over
+MAX_OPACITY. Each sum has to be less than 192. */
+static inline uint32_t addOpacity(uint32_t a, uint32_t b) {
+    uint32_t sum = a + b;
+    /* Adding this sets the high bit of the channels over MAX_OPACITY. */
+    uint32_t high = (sum + (0x7F - MAX_OPACITY) * 0x01010101u) & 0x80808080u;
+    uint32_t mask = (high >> 7) * 0xFF;
+    return (sum & ~mask) | (ALL_OPAQUE & mask);
+}
+
+/* Return how much light is absorbed going diagonally between two tiles,
+given the sum of their packed opacities. It's about as much as going through
+the average of the two, times sqrt(2), rounded down: 1.41 / 2 rounds to
+361 / 512 in a way that gives the same answer for every sum up to
+2 * MAX_OPACITY. Every other channel is spread out into 16 bits so each can
+be multiplied at once. */
+static inline uint32_t diagonalOpacity(uint32_t pair) {
+    uint32_t even = ((pair & 0x00FF00FFu) * 361 >> 9) & 0x007F007Fu;
+    uint32_t odd = (((pair >> 8) & 0x00FF00FFu) * 361 >> 9) & 0x007F007Fu;
+    return even | odd << 8;
+}
+
 Tile *Map::newTile(TileType val) {
     Tile *tile = nullptr;
     /* If it's a boulder, make a boulder. */
@@ -39,6 +117,22 @@ Tile *Map::newTile(TileType val) {
     }
     pointers[(unsigned int)val] = tile;
 
+    if (foregroundOpacity.size() < pointers.size()) {
+        foregroundOpacity.resize(pointers.size());
+        backgroundOpacity.resize(pointers.size());
+    }
+    /* Each color gets absorbed by its own amount. The sky's light is white,
+    so a, which is how much of it there is, gets absorbed by the average.
+    Tiles in the background only absorb part of what they would in the
+    foreground. */
+    DLight absorbed = tile -> getAbsorbed();
+    double sky = (absorbed.r + absorbed.g + absorbed.b) / 3;
+    foregroundOpacity[(unsigned int)val] = packOpacity(absorbed.r, absorbed.g,
+        absorbed.b, sky);
+    backgroundOpacity[(unsigned int)val] = packOpacity(
+        absorbed.r * absorbed.a, absorbed.g * absorbed.a, 
+        absorbed.b * absorbed.a, sky * absorbed.a);
+
     return tile;
 }
 
@@ -56,12 +150,17 @@ void Map::chooseSprite(int x, int y) {
     place.y = y;
     place.layer = MapLayer::FOREGROUND;
     Location spritePlace = getTile(place) -> getSpritePlace(*this, place);
-    findPointer(x, y) -> foregroundSprite 
-        = SpaceInfo::toSpritePlace(spritePlace);
+    int index;
+    Chunk *chunk = findChunk(x, y, index);
+    chunk -> foregroundSprite[index]
+        = SpritePlace::toSpritePlace(spritePlace);
     place.layer = MapLayer::BACKGROUND;
     spritePlace = getTile(place) -> getSpritePlace(*this, place);
-    findPointer(x, y) -> backgroundSprite 
-        = SpaceInfo::toSpritePlace(spritePlace);
+    chunk = findChunk(x, y, index);
+    chunk -> backgroundSprite[index]
+        = SpritePlace::toSpritePlace(spritePlace);
+    chunk -> dirty = true;
+    chunk -> renderVersion++;
 }
 
 bool Map::isBesideTile(int x, int y, MapLayer layer) {
@@ -92,209 +191,381 @@ inline bool Map::isSky(int x, int y) {
     assert(y >= 0);
     assert(y < height);
     x = wrapX(x);
-    return (getForeground(x, y) -> getIsSky()
-        && getBackground(x, y) -> getIsSky());
+    return y >= getSkyHeight(x) || isSkyTile(x, y);
 }
 
-void Map::effectLight(int x, int y, const Light &l, 
-        vector<vector<int>> &current) {
-    int mld = MAX_LIGHT_DEPTH;
-    assert(current.size() == 2 * MAX_LIGHT_DEPTH + 1);
-    assert(current[0][0] == -1);
-    assert(current[mld][mld] == -1);
-
-    /* Do pattern like breadth-first search. */
-    queue<Location> unvisited;
-    unvisited.push({0, 0, MapLayer::FOREGROUND});
-    DLight lback = getBackground(x, y) -> getAbsorbed();
-    current[MAX_LIGHT_DEPTH][MAX_LIGHT_DEPTH] = max(
-        getForeground(x, y) -> getAbsorbed().r, lback.r * lback.a);
-
-    while (!unvisited.empty()) {
-        Location loc = unvisited.front();
-        unvisited.pop();
+void Map::findSkyHeight(int x, int start) const {
+    int y = start;
+    while (y > 0 && isSkyTile(x, y - 1)) {
+        y--;
+    }
+    skyHeights[x] = y;
+}
+
+void Map::loadSkyHeights(int xstart, int xstop) const {
+    if (xstop - xstart > width) {
+        xstart = 0;
+        xstop = width;
+    }
+    for (int x = xstart; x < xstop; x++) {
+        getSkyHeight(x);
+    }
+}
+
+void Map::getOpacity(int x, int y, uint32_t *opacity) {
+    uint32_t empty = maxOpacity(foregroundOpacity[(int)TileType::EMPTY], 
+        backgroundOpacity[(int)TileType::EMPTY]);
+    for (int i = 0; i < LIGHT_GRID_SIZE; i++) {
+        int xi = x + i - MAX_LIGHT_DEPTH;
+        for (int j = 0; j < LIGHT_GRID_SIZE; j++) {
+            int yj = y + j - MAX_LIGHT_DEPTH;
+            if (yj < 0 || yj >= height) {
+                opacity[i * LIGHT_GRID_SIZE + j] = empty;
+                continue;
+            }
+            int index;
+            Chunk *chunk = findChunk(xi, yj, index);
+            opacity[i * LIGHT_GRID_SIZE + j] = maxOpacity(
+                foregroundOpacity[(int)chunk -> foreground[index]],
+                backgroundOpacity[(int)chunk -> background[index]]);
+        }
+    }
+}
+
+void Map::effectLight(int x, int y, uint32_t *current) {
+    const int size = LIGHT_GRID_SIZE;
+    /* Where the neighbours of a tile are in the grid, sides first, then
+    corners. */
+    static const int edges[4] = {-size, -1, size, 1};
+    static const int corners[4] = {-size - 1, size - 1, -size + 1, size + 1};
+
+    uint32_t opacity[LIGHT_GRID_AREA];
+    getOpacity(x, y, opacity);
+    fill_n(current, LIGHT_GRID_AREA, UNLIT);
+
+    /* Do pattern like breadth-first search. Every tile gets added to the
+    queue at most once, so it never needs to wrap around. All four channels
+    of light are spread at once, since they're packed into one number. */
+    int unvisited[LIGHT_GRID_AREA];
+    int first = 0;
+    int last = 0;
+    int center = MAX_LIGHT_DEPTH * size + MAX_LIGHT_DEPTH;
+    current[center] = opacity[center];
+    unvisited[last++] = center;
+
+    while (first < last) {
+        int place = unvisited[first++];
+        int i = place / size;
+        int j = place % size;
         /* Stop if we've gotten to the edge of where the light should reach. */
-        if (loc.x >= mld || loc.y >= mld || loc.x <= -1 * mld 
-                || loc.y <= -1 * mld) {
+        if (i == 0 || j == 0 || i == size - 1 || j == size - 1) {
             continue;
         }
 
-        int next = current[MAX_LIGHT_DEPTH + loc.x][MAX_LIGHT_DEPTH + loc.y];
+        uint32_t next = current[place];
         /* Stop if we've gotten to the edge of where the light reaches. */
-        if (next >= 64) {
+        if (next == ALL_OPAQUE) {
             continue;
         }
 
-        assert(next != -1);
-
-        Tile *fore = getTile(x + loc.x, y + loc.y, MapLayer::FOREGROUND);
-        Tile *back = getTile(x + loc.x, y + loc.y, MapLayer::BACKGROUND);
-        
-        int opacity = max(fore -> getAbsorbed().r, 
-            back -> getAbsorbed().r * back -> getAbsorbed().a);
-        int edge = next + opacity;
-
-        vector<Location> edges = {{-1, 0, (MapLayer)0}, {0, -1, (MapLayer)0}, 
-            {1, 0, (MapLayer)0}, {0, 1, (MapLayer)0}};
-        vector<Location> corners = {{-1, -1, (MapLayer)0}, {1, -1, (MapLayer)0},
-            {-1, 1, (MapLayer)0}, {1, 1, (MapLayer)0}};
-        for (int i = 0; i < 4; i++) {
-            int ix = mld + loc.x + edges[i].x;
-            int iy = mld + loc.y + edges[i].y;
-            if (current[ix][iy] == -1) {
-                current[ix][iy] = edge;
-                unvisited.push({ix - mld, iy - mld, (MapLayer)0});
+        assert(next != UNLIT);
+        uint32_t edge = addOpacity(next, opacity[place]);
+
+        for (int k = 0; k < 4; k++) {
+            int e = place + edges[k];
+            if (current[e] == UNLIT) {
+                current[e] = edge;
+                unvisited[last++] = e;
             }
             else {
-                current[ix][iy] = min(current[ix][iy], edge);
+                current[e] = minOpacity(current[e], edge);
             }
-            int cx = mld + loc.x + corners[i].x;
-            int cy = mld + loc.y + corners[i].y;
-            Tile *cfore = getForeground(x + cx - mld, y + cy - mld);
-            Tile *cback = getBackground(x + cx - mld, y + cy - mld);
-        
-            int copacity = max(cfore -> getAbsorbed().r, 
-                cback -> getAbsorbed().r * cback -> getAbsorbed().a);
-            int ccorner = next + 1.41 * (copacity + opacity) / 2.0;
-            if (current[cx][cy] == -1) {
-                current[cx][cy] = ccorner;
-                unvisited.push({cx - mld, cy - mld, (MapLayer)0});
+            int c = place + corners[k];
+            uint32_t corner = addOpacity(next, 
+                diagonalOpacity(opacity[c] + opacity[place]));
+            if (current[c] == UNLIT) {
+                current[c] = corner;
+                unvisited[last++] = c;
             }
             else {
-                current[cx][cy] = min(current[cx][cy], ccorner);
+                current[c] = minOpacity(current[c], corner);
             }
         }
     }
 }
 
 
-void Map::addLight(int x, int y, vector<vector<int>> &current, 
-        const Light &l) {
-    for (unsigned int i = 0; i < current.size(); i++) {
-        for (unsigned int j = 0; j < current[i].size(); j++) {
-            int xi = x + i - current.size() / 2;
-            int yi = y + j - current[i].size() / 2;
-            if (current[i][j] != -1) {
-                findPointer(xi, yi) -> light.setmax(
-                    l.times(getExpLight(current[i][j])));
-                current[i][j] = -1;
+void Map::addLight(int x, int y, const uint32_t *current, const Light &l) {
+    for (int i = 0; i < LIGHT_GRID_SIZE; i++) {
+        int xi = x + i - MAX_LIGHT_DEPTH;
+        for (int j = 0; j < LIGHT_GRID_SIZE; j++) {
+            int yj = y + j - MAX_LIGHT_DEPTH;
+            uint32_t absorbed = current[i * LIGHT_GRID_SIZE + j];
+            if (absorbed != UNLIT && 0 <= yj && yj < height) {
+                int index;
+                Chunk *chunk = findChunk(xi, yj, index);
+                chunk -> light[index].setmax(absorb(l, absorbed));
             }
         }
     }
 }
 
+void Map::spreadLight(int x, int y, const Light &light) {
+    uint32_t current[LIGHT_GRID_AREA];
+    effectLight(x, y, current);
+    addLight(x, y, current, light);
+}
+
+void Map::markColumns(uint64_t *row, int first, int last) {
+    assert(first <= last);
+    int firstWord = first / 64;
+    int lastWord = last / 64;
+    uint64_t firstMask = ~(uint64_t)0 << (first % 64);
+    uint64_t lastMask = ~(uint64_t)0 >> (63 - last % 64);
+    if (firstWord == lastWord) {
+        row[firstWord] |= firstMask & lastMask;
+        return;
+    }
+    row[firstWord] |= firstMask;
+    for (int i = firstWord + 1; i < lastWord; i++) {
+        row[i] = ~(uint64_t)0;
+    }
+    row[lastWord] |= lastMask;
+}
+
 void Map::setLight(int xstart, int ystart, int xstop, int ystop) {
     int mld = MAX_LIGHT_DEPTH;
     bool done = true;
+    lightStats.calls++;
     int xlookstart = wrapX(xstart - MAX_LIGHT_DEPTH);
     int xlookstop = wrapX(xstop + MAX_LIGHT_DEPTH);
     int ylookstart = min(max(0, ystart - MAX_LIGHT_DEPTH), height - 1);
     int ylookstop = min(max(0, ystop + MAX_LIGHT_DEPTH), height - 1);
-    set<Location> toCheck;
+
+    /* The part of the map light sources can be found in, and the tiles in it
+    to check, as rows of bits. */
+    int left = max(0, xlookstart - 2 * mld);
+    int right = min(width, xlookstop + 2 * mld + 1);
+    int bottom = max(0, ylookstart - 2 * mld);
+    int top = min(height, ylookstop + 2 * mld + 1);
+    int rowWords = (max(0, right - left) + 63) / 64;
+    if ((int)toCheck.size() < rowWords * max(0, top - bottom)) {
+        toCheck.resize(rowWords * (top - bottom));
+    }
+    fill_n(toCheck.begin(), rowWords * max(0, top - bottom), 0);
+    /* Add a square of tiles to the ones to check, leaving out any that aren't
+    on the map. */
+    auto check = [&](int x0, int y0, int x1, int y1) {
+        x0 = max(x0, left);
+        x1 = min(x1, right - 1);
+        y0 = max(y0, bottom);
+        y1 = min(y1, top - 1);
+        if (x0 > x1) {
+            return;
+        }
+        for (int y = y0; y <= y1; y++) {
+            markColumns(&toCheck[(y - bottom) * rowWords], x0 - left, 
+                x1 - left);
+        }
+    };
+
     /* Loop through and make sure none need to be updated. */
     for (int i = xlookstart; i < xlookstop; i++) {
         for (int j = ylookstart; j < ylookstop; j++) {
             bool change = false;
-            if (findPointer(i, j) -> lightRemoved) {
+            int index;
+            Chunk *chunk = findChunk(i, j, index);
+            if (chunk -> lightRemoved[index]) {
                 done = false;
-                findPointer(i, j) -> lightRemoved = false;
+                chunk -> lightRemoved[index] = false;
 
                 /* The map itself will be used to keep track of the summation 
                 of lights we have calculated so far. */
                 for (int x = i - 1 * mld; x <= i + mld; x++) {
                     for (int y = j - 1 * mld; y <= j + mld; y++) {
-                        findPointer(x, y) -> light = Light(0, 0, 0, 0);
+                        int near;
+                        Chunk *nearChunk = findChunk(x, y, near);
+                        nearChunk -> light[near] = Light(0, 0, 0, 0);
                     }
                 }
+                lightStats.tilesCleared += LIGHT_GRID_AREA;
 
                 /* Add anything that could affect those to the list of lights to
                 calculate. */
-                for (int x = i - 2 * mld; x <= i + 2 * mld; x++) {
-                    for (int y = j - 2 * mld; y <= j + 2 * mld; y++) {
-                        if (isOnMap(x, y)) {
-                            toCheck.insert({x, y, (MapLayer)0});
-                        }
-                    }
-                }
+                check(i - 2 * mld, j - 2 * mld, i + 2 * mld, j + 2 * mld);
                 
             }
-            if (findPointer(i, j) -> lightAdded) {
+            if (chunk -> lightAdded[index]) {
                 change = true;
-                findPointer(i, j) -> lightAdded = false;
+                chunk -> lightAdded[index] = false;
             }
             if (i >= xstart && i < xstop && j >= ystart && j < ystop
-                    && !findPointer(i, j) -> isLightUpdated) {
+                    && !chunk -> isLightUpdated[index]) {
                 change = true;
-                findPointer(i, j) -> isLightUpdated = true;
+                chunk -> isLightUpdated[index] = true;
             }
 
             if (change) {
                 done = false;
                 /* Add anything that could affect those to the list of lights to
                 calculate. */
-                for (int x = i - mld; x <= i + mld; x++) {
-                    for (int y = j - mld; y <= j + mld; y++) {
-                        if (isOnMap(x, y)) {
-                            toCheck.insert({x, y, (MapLayer)0});
-                        }
-                    }
-                }
+                check(i - mld, j - mld, i + mld, j + mld);
             }
         }
     }
     if (done) {
         return;
     }
+    for (int i = 0; i < rowWords * (top - bottom); i++) {
+        lightStats.tilesChecked += __builtin_popcountll(toCheck[i]);
+    }
+
+    int rows = top - bottom;
+    int threads = getLightThreads();
+    if (threads == 1 || rows < 2 * LIGHT_GRID_SIZE) {
+        checkLightRows(bottom, top, bottom, left, rowWords);
+        return;
+    }
 
-    vector<vector<int>> current;
-    current.resize(2 * MAX_LIGHT_DEPTH + 1);
-    for (unsigned int i = 0; i < current.size(); i++) {
-        current[i].resize(2 * MAX_LIGHT_DEPTH + 1, -1);
-    }
-
-    // TODO: Make an array to keep track of the summation of darkness we have
-    // so far.
-
-    /* Loop over the map looking for light sources. */
-    set<Location>::iterator it;
-    for (it = toCheck.begin(); it != toCheck.end(); it++) {
-        int x = it -> x;
-        int y = it -> y;
-        assert(isOnMap(x, y));
-        if (isSky(x, y)) {
-            findPointer(x, y) -> light = getSkyLight();
-            bool used = false;
-            /* If there's a non-sky tile next to it, this sky is a light
-            source. */
-            for (int i = -1; i < 2; i++) {
-                for (int j = -1; j < 2; j++) {
-                    if (isOnMap(x + i, y + j) && !isSky(x + i, y + j)
-                            /* Avoid recaclutating. */
-                            && !used) {
-                        used = true;
-                        effectLight(x, y, Light(0, 0, 0, 255), current);
-                        addLight(x, y, current, Light(0, 0, 0, 255));
-                    }
+    /* Split the rows into bands at least as tall as the area a light source
+    can reach, so bands that aren't next to each other never change the same
+    tiles. Every other band is done at once, then the rest. Since light only
+    ever gets set to the brighter of two values, the order doesn't change the
+    result. */
+    loadChunks(left - 2 * mld, bottom - mld, right + 2 * mld, top + mld);
+    loadSkyHeights(left - 1, right + 1);
+    int bandHeight = max(LIGHT_GRID_SIZE, 
+        (rows + 2 * threads - 1) / (2 * threads));
+    int bands = (rows + bandHeight - 1) / bandHeight;
+    for (int parity = 0; parity < 2; parity++) {
+        lightWorkers -> run((bands - parity + 1) / 2, [&](int k) {
+            int band = 2 * k + parity;
+            int first = bottom + band * bandHeight;
+            checkLightRows(first, min(top, first + bandHeight), bottom, left,
+                rowWords);
+        });
+    }
+}
+
+void Map::checkLightRows(int first, int last, int bottom, int left, 
+        int rowWords) {
+    /* Loop over the map looking for light sources, from the top row down
+    and left to right along each row. */
+    for (int y = last - 1; y >= first; y--) {
+        uint64_t *row = &toCheck[(y - bottom) * rowWords];
+        for (int word = 0; word < rowWords; word++) {
+            /* Go through the set bits, lowest first. */
+            for (uint64_t bits = row[word]; bits; bits &= bits - 1) {
+                int x = left + word * 64 + __builtin_ctzll(bits);
+                checkLightSource(x, y);
+            }
+            row[word] = 0;
+        }
+    }
+}
+
+void Map::loadChunks(int xstart, int ystart, int xstop, int ystop) const {
+    ystart = max(0, ystart);
+    ystop = min(height, ystop);
+    if (xstop - xstart > width) {
+        xstart = 0;
+        xstop = width;
+    }
+    /* Look at one tile at least every CHUNK_SIZE tiles, and at the last
+    one, so every chunk gets looked at. */
+    for (int y = ystart; y < ystop + CHUNK_SIZE; y += CHUNK_SIZE) {
+        for (int x = xstart; x < xstop + CHUNK_SIZE; x += CHUNK_SIZE) {
+            int index;
+            findChunk(min(x, xstop - 1), min(y, ystop - 1), index);
+        }
+    }
+}
+
+void Map::setLightThreads(int threads) {
+    delete lightWorkers;
+    lightWorkers = nullptr;
+    if (threads > 1) {
+        lightWorkers = new WorkerPool(threads - 1);
+    }
+}
+
+void Map::setDynamicLight(int xstart, int ystart, int xstop, int ystop) {
+    int mld = MAX_LIGHT_DEPTH;
+    dynamicLeft = wrapX(xstart);
+    dynamicBottom = ystart;
+    dynamicWidth = min(width, max(0, xstop - xstart));
+    dynamicHeight = max(0, ystop - ystart);
+    dynamicLight.assign(dynamicWidth * dynamicHeight, Light());
+
+    uint32_t current[LIGHT_GRID_AREA];
+    for (unsigned int e = 0; e < emitters.size(); e++) {
+        const Emitter &emitter = emitters[e];
+        /* Skip emitters too far away to light anything on screen. */
+        if (emitter.y < 0 || emitter.y >= height
+                || emitter.y + mld < dynamicBottom
+                || emitter.y - mld >= dynamicBottom + dynamicHeight
+                || wrapX(emitter.x + mld - dynamicLeft) 
+                    >= dynamicWidth + 2 * mld) {
+            continue;
+        }
+
+        /* Spread it the same way as light from tiles. */
+        effectLight(emitter.x, emitter.y, current);
+        for (int i = 0; i < LIGHT_GRID_SIZE; i++) {
+            int dx = wrapX(emitter.x + i - mld - dynamicLeft);
+            for (int j = 0; j < LIGHT_GRID_SIZE; j++) {
+                int dy = emitter.y + j - mld - dynamicBottom;
+                uint32_t absorbed = current[i * LIGHT_GRID_SIZE + j];
+                if (absorbed != UNLIT && dx < dynamicWidth && 0 <= dy 
+                        && dy < dynamicHeight) {
+                    dynamicLight[dy * dynamicWidth + dx].setmax(
+                        absorb(emitter.light, absorbed));
                 }
             }
         }
+    }
+}
 
-        /* If this tile is a light source */
-        Light emitted = getTile(x, y, MapLayer::FOREGROUND) -> getEmitted();
-        if (emitted.r != 0 || emitted.g != 0 || emitted.b != 0) {
-            effectLight(x, y, emitted, current);
-            addLight(x, y, current, emitted);
+void Map::checkLightSource(int x, int y) {
+    assert(isOnMap(x, y));
+    if (isSky(x, y)) {
+        int index;
+        Chunk *chunk = findChunk(x, y, index);
+        chunk -> light[index] = getSkyLight();
+        /* If the row below is above the sky height of this column and the
+        ones beside it, every tile next to this one is sky, so there's no
+        need to look. */
+        int below = max(getSkyHeight(x), max(getSkyHeight(x - 1), 
+            getSkyHeight(x + 1)));
+        bool used = (y - 1 >= below);
+        /* If there's a non-sky tile next to it, this sky is a light
+        source. */
+        for (int i = -1; i < 2; i++) {
+            for (int j = -1; j < 2; j++) {
+                if (isOnMap(x + i, y + j) && !isSky(x + i, y + j)
+                        /* Avoid recaclutating. */
+                        && !used) {
+                    used = true;
+                    spreadLight(x, y, Light(0, 0, 0, 255));
+                }
+            }
         }
+    }
 
-        // possible TODO: light sources in the background (maybe just no)
-        // TODO: darksources
-        // TODO: movable lights
+    /* If this tile is a light source */
+    Light emitted = getTile(x, y, MapLayer::FOREGROUND) -> getEmitted();
+    if (emitted.r != 0 || emitted.g != 0 || emitted.b != 0) {
+        spreadLight(x, y, emitted);
     }
 
+    // possible TODO: light sources in the background (maybe just no)
+    // TODO: darksources
 }
 
 void Map::updateNear(int x, int y) {
-    findPointer(wrapX(x), y) -> isLightUpdated = false;
+    int index;
+    Chunk *chunk = findChunk(wrapX(x), y, index);
+    chunk -> isLightUpdated[index] = false;
     /* Value that takes into account x-wrapping of the map. */
     Location fore;
     Location back;
@@ -350,99 +621,422 @@ int Map::bordering(const Location &place) {
     return col;
 }
 
-void Map::saveLayer(MapLayer layer, ofstream &outfile) const {
-    // For keeping track of a lot of the same tile in a row
-    int count = 0;
-    TileType current, last;
-    /* Just to get rid of the "may be uninitialized" compile warning.
-    (It can't be uninitialized because of the assertions.) */
-    last = TileType::EMPTY;
+/* Append the compressed tiles of a chunk to out. Only the first w columns
+and h rows are on the map. It works for both Chunks and SavedChunks. */
+template<class T>
+static void encodeChunk(const T &chunk, int w, int h, string &out) {
+    assert(w > 0);
+    assert(h > 0);
+    /* Tiles are stored row by row within the chunk, leaving out any that
+    are off the map. */
+    MapFile::encodeLayer(out, chunk.foreground, w, h, CHUNK_SIZE);
+    MapFile::encodeLayer(out, chunk.background, w, h, CHUNK_SIZE);
+    MapFile::encodeLayer(out, chunk.foregroundSprite, w, h, CHUNK_SIZE);
+    MapFile::encodeLayer(out, chunk.backgroundSprite, w, h, CHUNK_SIZE);
+}
+
+MapSnapshot::~MapSnapshot() {
+    for (unsigned int i = 0; i < chunks.size(); i++) {
+        delete chunks[i];
+    }
+}
 
+bool MapSnapshot::write(const string &filename) const {
+    MapFileHeader written = header;
+    int chunksWide = header.chunksWide;
+    int chunksHigh = header.chunksHigh;
+
+    /* Leave room for the header and the chunk index, which get filled in
+    once we know where everything ended up. */
+    string data;
+    data.resize(sizeof(MapFileHeader) 
+        + chunksWide * chunksHigh * sizeof(ChunkRecord));
+
+    /* Biome information. */
+    vector<uint8_t> biomeTypes(biomes.size());
+    for (unsigned int i = 0; i < biomes.size(); i++) {
+        biomeTypes[i] = (uint8_t)biomes[i].biome;
+    }
+    written.biomeOffset = data.size();
+    MapFile::encodeLayer(data, biomeTypes.data(), header.biomesWide, 
+        header.biomesHigh, header.biomesWide);
+    written.biomeSize = data.size() - written.biomeOffset;
+    MapFile::writeValueAt(data, 0, written);
+
+    /* Compress the tiles in bands of rows of chunks, each on its own
+    thread. Each band keeps track of where its chunks are relative to its own
+    start. */
+    int bandCount = max(1, min((int)thread::hardware_concurrency(), 
+        chunksHigh));
+    vector<string> bands(bandCount);
+    vector<ChunkRecord> index(chunksWide * chunksHigh);
+    auto encodeBand = [&](int band) {
+        string &out = bands[band];
+        for (int j = band * chunksHigh / bandCount; 
+                j < (band + 1) * chunksHigh / bandCount; j++) {
+            for (int i = 0; i < chunksWide; i++) {
+                int chunk = j * chunksWide + i;
+                index[chunk].offset = out.size();
+                if (chunks[chunk]) {
+                    /* Chunks on the top and right edges may be cut off. */
+                    int w = min(CHUNK_SIZE, header.width - i * CHUNK_SIZE);
+                    int h = min(CHUNK_SIZE, header.height - j * CHUNK_SIZE);
+                    encodeChunk(*chunks[chunk], w, h, out);
+                }
+                else {
+                    /* Nothing has looked at it since it was loaded, so it
+                    can't have changed. */
+                    const ChunkRecord &old = records[chunk];
+                    out.append(source + old.offset, old.size);
+                }
+                index[chunk].size = out.size() - index[chunk].offset;
+            }
+        }
+    };
+    vector<thread> workers;
+    for (int band = 1; band < bandCount; band++) {
+        workers.emplace_back(encodeBand, band);
+    }
+    encodeBand(0);
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    /* Put the bands one after another, and fill in the index. */
+    for (int band = 0; band < bandCount; band++) {
+        for (int j = band * chunksHigh / bandCount; 
+                j < (band + 1) * chunksHigh / bandCount; j++) {
+            for (int i = 0; i < chunksWide; i++) {
+                int chunk = j * chunksWide + i;
+                index[chunk].offset += data.size();
+                MapFile::writeValueAt(data, sizeof(MapFileHeader) 
+                    + chunk * sizeof(ChunkRecord), index[chunk]);
+            }
+        }
+        data += bands[band];
+    }
+
+    /* Write to a different file and then move it over the old one, so that
+    if something goes wrong partway through the old save is still there. */
+    string tempname = filename + ".tmp";
+    ofstream outfile(tempname, ios::binary);
+    outfile.write(data.data(), data.size());
+    outfile.close();
+    if (!outfile) {
+        cerr << "Couldn't write " << tempname << "\n";
+        return false;
+    }
+    if (rename(tempname.c_str(), filename.c_str()) != 0) {
+        cerr << "Couldn't move " << tempname << " to " << filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+MapSnapshot *Map::takeSnapshot() {
     assert(height != 0);
     assert(width != 0);
+    assert(biomes.size() == (unsigned int)(biomesWide * biomesHigh));
 
-    // Treat the array as the 1D array it is.
-    for (int index = 0; index < height * width; index++) {
-        /* Get a tiletype from the correct layer. */
-        if (layer == MapLayer::FOREGROUND) {
-            current = tiles[index].foreground;
+    MapSnapshot *snapshot = new MapSnapshot();
+
+    /* Write an informative header. */
+    MapFileHeader &header = snapshot -> header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAP_FILE_MAGIC, MAP_FILE_MAGIC_SIZE);
+    header.formatVersion = MAP_FILE_VERSION;
+    header.major = MAJOR;
+    header.minor = MINOR;
+    header.patch = PATCH;
+    header.width = width;
+    header.height = height;
+    header.spawnX = spawn.x;
+    header.spawnY = spawn.y;
+    header.seed = seed;
+    header.chunkSize = CHUNK_SIZE;
+    header.chunksWide = chunksWide;
+    header.chunksHigh = chunksHigh;
+    header.biomesWide = biomesWide;
+    header.biomesHigh = biomesHigh;
+
+    snapshot -> biomes = biomes;
+    snapshot -> source = source;
+    snapshot -> records = chunkRecords;
+    snapshot -> chunks.resize(chunks.size(), nullptr);
+    for (unsigned int i = 0; i < chunks.size(); i++) {
+        if (chunks[i]) {
+            SavedChunk *copy = new SavedChunk();
+            memcpy(copy -> foreground, chunks[i] -> foreground, 
+                sizeof(copy -> foreground));
+            memcpy(copy -> background, chunks[i] -> background, 
+                sizeof(copy -> background));
+            memcpy(copy -> foregroundSprite, chunks[i] -> foregroundSprite, 
+                sizeof(copy -> foregroundSprite));
+            memcpy(copy -> backgroundSprite, chunks[i] -> backgroundSprite, 
+                sizeof(copy -> backgroundSprite));
+            snapshot -> chunks[i] = copy;
+            chunks[i] -> dirty = false;
         }
-        else {
-            assert(layer == MapLayer::BACKGROUND);
-            current = tiles[index].background;
-        }
-        if(index != 0 && current != last) {
-            outfile << count << " ";
-            outfile << (int)last << " ";
-            count = 1;
+    }
+    return snapshot;
+}
+
+void Map::save(std::string filename) {
+    /* Don't let a background save write to the file at the same time. */
+    finishSave();
+    MapSnapshot *snapshot = takeSnapshot();
+    if (snapshot -> write(filename)) {
+        savedFile = filename;
+        appendedChunks = 0;
+    }
+    delete snapshot;
+}
+
+void Map::saveInBackground(const string &filename) {
+    finishSave();
+    MapSnapshot *snapshot = takeSnapshot();
+    /* If this fails, the next full save will have everything anyways. */
+    savedFile = filename;
+    appendedChunks = 0;
+    isSaving = true;
+    saveThread = new thread(&Map::writeSnapshot, snapshot, filename,
+        &isSaving);
+}
+
+void Map::writeSnapshot(MapSnapshot *snapshot, string filename,
+        atomic<bool> *isSaving) {
+    snapshot -> write(filename);
+    delete snapshot;
+    *isSaving = false;
+}
+
+void Map::autosave(const string &filename) {
+    /* If the last save is still writing, try again next time. */
+    if (isSaving) {
+        return;
+    }
+
+    if (filename != savedFile || appendedChunks > chunks.size()) {
+        saveInBackground(filename);
+        return;
+    }
+    finishSave();
+
+    string data;
+    vector<int> indices;
+    vector<ChunkRecord> records;
+    for (unsigned int i = 0; i < chunks.size(); i++) {
+        if (chunks[i] && chunks[i] -> dirty) {
+            int chunkX = i % chunksWide;
+            int chunkY = i / chunksWide;
+            ChunkRecord record;
+            record.offset = data.size();
+            int w = min(CHUNK_SIZE, width - chunkX * CHUNK_SIZE);
+            int h = min(CHUNK_SIZE, height - chunkY * CHUNK_SIZE);
+            encodeChunk(*chunks[i], w, h, data);
+            record.size = data.size() - record.offset;
+            chunks[i] -> dirty = false;
+            indices.push_back(i);
+            records.push_back(record);
         }
-        else {
-            count ++;
+    }
+    if (indices.empty()) {
+        return;
+    }
+
+    appendedChunks += indices.size();
+    isSaving = true;
+    saveThread = new thread(&Map::appendChunks, filename, move(data), 
+        move(indices), move(records), &isSaving);
+}
+
+void Map::appendChunks(string filename, string data, vector<int> indices,
+        vector<ChunkRecord> records, atomic<bool> *isSaving) {
+    int fd = open(filename.c_str(), O_RDWR);
+    MapFileHeader header;
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0
+            || pread(fd, &header, sizeof(header), 0) != sizeof(header)
+            || memcmp(header.magic, MAP_FILE_MAGIC, MAP_FILE_MAGIC_SIZE)
+            || header.formatVersion != MAP_FILE_VERSION) {
+        cerr << "Couldn't autosave to " << filename << "\n";
+        if (fd >= 0) {
+            close(fd);
         }
-        last = current;
+        *isSaving = false;
+        return;
     }
 
-    // Write the last set of numbers
-    outfile << count << " " << (int)last << " ";
+    /* Write the chunks and make sure they're on the disk before anything
+    points to them, so a crash partway through leaves the old chunks in
+    use. */
+    off_t end = info.st_size;
+    bool written = pwrite(fd, data.data(), data.size(), end) 
+        == (ssize_t)data.size() && fsync(fd) == 0;
+    for (unsigned int i = 0; written && i < indices.size(); i++) {
+        assert(indices[i] < (int)(header.chunksWide * header.chunksHigh));
+        records[i].offset += end;
+        off_t place = sizeof(MapFileHeader) + indices[i] * sizeof(ChunkRecord);
+        written = pwrite(fd, &records[i], sizeof(ChunkRecord), place)
+            == sizeof(ChunkRecord);
+    }
+    if (!written || fsync(fd) != 0) {
+        cerr << "Couldn't autosave to " << filename << "\n";
+    }
+    close(fd);
+    *isSaving = false;
 }
 
-void Map::save(std::string filename) const {
-    // Saves in .bmp file format in black and white
-    std::ofstream outfile;
-    outfile.open(filename);
+void Map::finishSave() {
+    if (saveThread) {
+        saveThread -> join();
+        delete saveThread;
+        saveThread = nullptr;
+    }
+}
 
-    // Write an informative header
-    outfile << "#Map\n" << MAJOR << " " << MINOR << " " << PATCH << "\n";
-    outfile << width << " " << height << "\n";
-    outfile << spawn.x << " " << spawn.y << "\n";
-    outfile << seed << "\n";
-    // Write tile values
-    outfile << "#Foreground\n";
-    saveLayer(MapLayer::FOREGROUND, outfile);
+bool Map::loadChunk(int chunkX, int chunkY, const char *p, 
+        const char *end) const {
+    int xstart = chunkX * CHUNK_SIZE;
+    int ystart = chunkY * CHUNK_SIZE;
+    int w = min(CHUNK_SIZE, width - xstart);
+    int h = min(CHUNK_SIZE, height - ystart);
+    assert(w > 0);
+    assert(h > 0);
+
+    Chunk *chunk = chunks[chunkY * chunksWide + chunkX];
+    assert(chunk != nullptr);
+    return MapFile::decodeLayer(p, end, chunk -> foreground, w, h, CHUNK_SIZE)
+        && MapFile::decodeLayer(p, end, chunk -> background, w, h, CHUNK_SIZE)
+        && MapFile::decodeLayer(p, end, chunk -> foregroundSprite, w, h, 
+            CHUNK_SIZE)
+        && MapFile::decodeLayer(p, end, chunk -> backgroundSprite, w, h,
+            CHUNK_SIZE);
+}
 
-    /* Time for the background. */
-    outfile << "\n#Background\n";
-    saveLayer(MapLayer::BACKGROUND, outfile);
+void Map::decodeChunk(int chunk) const {
+    assert(chunks[chunk] == nullptr);
+    assert(source);
+    chunks[chunk] = new Chunk();
+    newChunks.push_back(chunk);
+
+    const ChunkRecord &record = chunkRecords[chunk];
+    if (!loadChunk(chunk % chunksWide, chunk / chunksWide, 
+            source + record.offset, source + record.offset + record.size)) {
+        cerr << "Couldn't load chunk " << chunk % chunksWide << ", ";
+        cerr << chunk / chunksWide << "!\n";
+    }
+}
 
-    /* Biome information. */
-    outfile << "\n#Biomes\n";
-    assert(biomes.size() == (unsigned int)(biomesWide * biomesHigh));
-    assert(biomesWide != 0);
-    assert(biomesHigh != 0);
-
-    int count = 0;
-    BiomeType current;
-    /* Some random value so I don't get uninitialized value compile warnings.
-    Because of the if statement, it won't be uninitialized if it's used, as 
-    long as the map has nonzero size (which is asserted).
-    */
-    BiomeType last = BiomeType::GRASSLAND;
-    for (int i = 0; i < biomesWide * biomesHigh; i++) {
-        current = biomes[i].biome;
-        if (i != 0 && current != last) {
-            outfile << count << " " << (int)last << " ";
-            count = 1;
-        }
-        else {
-            count++;
+void Map::addChunkToUpdate(int chunk) {
+    int xstart = (chunk % chunksWide) * CHUNK_SIZE;
+    int ystart = (chunk / chunksWide) * CHUNK_SIZE;
+    int xstop = min(xstart + CHUNK_SIZE, width);
+    int ystop = min(ystart + CHUNK_SIZE, height);
+    for (int i = xstart; i < xstop; i++) {
+        for (int j = ystart; j < ystop; j++) {
+            addToUpdate(i, j, MapLayer::FOREGROUND);
+            addToUpdate(i, j, MapLayer::BACKGROUND);
         }
-        last = current;
     }
+}
 
-    /* One last set of biome values. */
-    outfile << count << " " << (int)last << " ";
+void Map::allocate() {
+    assert(chunks.empty());
+    biomes.resize(biomesWide * biomesHigh);
+    skyHeights.assign(width, -1);
+    newChunks.clear();
+    for (int i = 0; i < chunksWide * chunksHigh; i++) {
+        chunks.push_back(new Chunk());
+        newChunks.push_back(i);
+    }
+}
 
-    /* All the other data. */
-    outfile << "\n#Other\n";
-    for (int i = 0; i < width * height; i++) {
-        outfile << (int)tiles[i].foregroundSprite << " ";
-        outfile << (int)tiles[i].backgroundSprite << " ";
+void Map::loadBinary(const char *data, size_t size, const string &filename) {
+    const char *p = data;
+    const char *end = data + size;
+
+    MapFileHeader header;
+    if (!MapFile::readValue(p, end, header) 
+            || memcmp(header.magic, MAP_FILE_MAGIC, MAP_FILE_MAGIC_SIZE)) {
+        string message = filename + " doesn't say it's a map.\n";
+        cerr << message;
+        throw message;
+    }
+    if (header.formatVersion != MAP_FILE_VERSION) {
+        string message = filename + " uses save format version " 
+            + to_string(header.formatVersion) + ", but this software can "
+            + "only read version " + to_string(MAP_FILE_VERSION) + ".\n";
+        cerr << message;
+        throw message;
     }
+    checkVersion(header.major, header.minor, header.patch);
 
-    outfile.close();
+    /* Read in the things. */
+    setWidth(header.width);
+    setHeight(header.height);
+    if (header.chunkSize != CHUNK_SIZE 
+            || header.chunksWide != (uint32_t)chunksWide
+            || header.chunksHigh != (uint32_t)chunksHigh
+            || header.biomesWide != (uint32_t)biomesWide
+            || header.biomesHigh != (uint32_t)biomesHigh) {
+        string message = filename + " has the wrong number of chunks or "
+            + "biomes for its size.\n";
+        cerr << message;
+        throw message;
+    }
+    spawn.x = header.spawnX;
+    spawn.y = header.spawnY;
+    seed = header.seed;
+    biomes.resize(biomesWide * biomesHigh);
+
+    /* Load biome information. */
+    bool loaded = header.biomeOffset + header.biomeSize <= size;
+    if (loaded) {
+        const char *biomeStart = data + header.biomeOffset;
+        vector<uint8_t> biomeTypes(biomes.size());
+        loaded = MapFile::decodeLayer(biomeStart, 
+            biomeStart + header.biomeSize, biomeTypes.data(), biomesWide,
+            biomesHigh, biomesWide);
+        for (unsigned int i = 0; loaded && i < biomes.size(); i++) {
+            biomes[i].biome = (BiomeType)biomeTypes[i];
+        }
+    }
+    if (!loaded) {
+        cerr << "Couldn't load biome information!\n";
+    }
+
+    /* Read the chunk index, which is right after the header. The chunks
+    themselves get loaded when they're used. */
+    chunkRecords.resize(chunksWide * chunksHigh);
+    for (unsigned int i = 0; i < chunkRecords.size(); i++) {
+        ChunkRecord &record = chunkRecords[i];
+        if (!MapFile::readValue(p, end, record)
+                || record.offset + record.size > size) {
+            cerr << "Couldn't load chunk " << i % chunksWide << ", ";
+            cerr << i / chunksWide << "!\n";
+            /* Leave it empty. */
+            record.offset = 0;
+            record.size = 0;
+        }
+    }
+    chunks.assign(chunksWide * chunksHigh, nullptr);
+    skyHeights.assign(width, -1);
+    newChunks.clear();
+    savedFile = filename;
+}
+
+void Map::checkVersion(int major, int minor, int patch) const {
+    if (major != MAJOR || minor != MINOR) {
+        cerr << "Warning: This map was written with version ";
+        cerr << major << "." << minor << "." << patch << ", ";
+        cerr << "but this software is version " << MAJOR << ".";
+        cerr << MINOR << "." << PATCH << "." << " The save format may ";
+        cerr << "have changed.\n";
+    }
 }
 
-void Map::loadLayer(MapLayer layer, ifstream &infile) {
+void Map::loadLayer(MapLayer layer, istream &infile) {
     int index = 0;
     int count, tile;
     TileType current;
@@ -451,39 +1045,21 @@ void Map::loadLayer(MapLayer layer, ifstream &infile) {
         current = (TileType)tile;
         for (int i = 0; i < count; i++) {
             assert(index < width * height);
+            int place;
+            Chunk *chunk = rawChunk(index % width, index / width, place);
             if (layer == MapLayer::FOREGROUND) {
-                tiles[index].foreground  = current;
+                chunk -> foreground[place] = current;
             }
             else {
                 assert(layer == MapLayer::BACKGROUND);
-                tiles[index].background = current;
+                chunk -> background[place] = current;
             }
             ++index;
         }
     }
-    assert(getForeground(0, 0) -> type == tiles[0].foreground);
 }
 
-// Constructor
-Map::Map(string filename, int tileWidth, int tileHeight, string p) : 
-        TILE_WIDTH(tileWidth), TILE_HEIGHT(tileHeight) {
-    /* It's the 0th tick. */
-    tick = 0;
-    ifstream infile(filename);
-    path = p;
-
-    exps.resize(MAX_OPACITY, 0);
-
-    /* Create a tile object for each type. */
-    for (int i = 0; i <= (int)TileType::LAST_TILE; i++) {
-        newTile((TileType)i);
-    }
-
-    /* Check that the file could be opened. */
-    if (!infile) {
-        cerr << "Can't open " << filename << "\n";
-    }
-
+void Map::loadText(istream &infile, const string &filename) {
     /* Check that the header is #Map, just in case we were given an entirely
     wrong file. */
     string header;
@@ -496,20 +1072,13 @@ Map::Map(string filename, int tileWidth, int tileHeight, string p) :
     string minor;
     string patch;
     infile >> major >> minor >> patch;
-    if (stoi(major) != MAJOR || stoi(minor) != MINOR) {
-        cerr << "Warning: This map was written with version ";
-        cerr << major << "." << minor << "." << patch << ", ";
-        cerr << "but this software is version " << MAJOR << ".";
-        cerr << MINOR << "." << PATCH << "." << " The save format may ";
-        cerr << "have changed.\n";
-    }
+    checkVersion(stoi(major), stoi(minor), stoi(patch));
 
     /* Read in the things. */
     infile >> width >> height;
     setWidth(width);
     setHeight(height);
-    tiles = new SpaceInfo[width * height];
-    biomes.resize(biomesWide * biomesHigh);
+    allocate();
     infile >> spawn.x >> spawn.y;
     infile >> seed;
 
@@ -557,29 +1126,102 @@ Map::Map(string filename, int tileWidth, int tileHeight, string p) :
     }
 
     for (int i = 0; i < width * height; i++) {
+        int index;
+        Chunk *chunk = rawChunk(i % width, i / width, index);
         int spritePlace;
         infile >> spritePlace;
-        tiles[i].foregroundSprite = (uint8_t)spritePlace;
+        chunk -> foregroundSprite[index] = (uint8_t)spritePlace;
         infile >> spritePlace;
-        tiles[i].backgroundSprite = (uint8_t)spritePlace;
+        chunk -> backgroundSprite[index] = (uint8_t)spritePlace;
     }
+}
 
-    /* Iterate over the entire map. */
-    Location fore;
-    Location back;
-    fore.layer = MapLayer::FOREGROUND;
-    back.layer = MapLayer::BACKGROUND;
-    for (int i = 0; i < width; i++) {
-        fore.x = i;
-        back.x = i;
-        for (int j = 0; j < height; j++) {
-            fore.y = j;
-            back.y = j;
-            /* Add the appropriate tiles to our list of tiles to update. */
-            addToUpdate(fore);
-            addToUpdate(back);
+// Constructor
+Map::Map(string filename, int tileWidth, int tileHeight, string p) : 
+        TILE_WIDTH(tileWidth), TILE_HEIGHT(tileHeight) {
+    /* It's the 0th tick. */
+    tick = 0;
+    source = nullptr;
+    sourceSize = 0;
+    appendedChunks = 0;
+    saveThread = nullptr;
+    isSaving = false;
+    lightWorkers = nullptr;
+    resetLightStats();
+    dynamicLeft = 0;
+    dynamicBottom = 0;
+    dynamicWidth = 0;
+    dynamicHeight = 0;
+    path = p;
+
+    /* Create a tile object for each type. */
+    for (int i = 0; i <= (int)TileType::LAST_TILE; i++) {
+        newTile((TileType)i);
+    }
+
+    /* Map the file into memory instead of reading it, so that only the
+    parts that get used are read from the disk. */
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0) {
+        string message = "Can't open " + filename + "\n";
+        cerr << message;
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw message;
+    }
+    sourceSize = info.st_size;
+    void *data = mmap(nullptr, sourceSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    /* The mapping stays valid after the file is closed. */
+    close(fd);
+    if (data == MAP_FAILED) {
+        string message = "Can't map " + filename + " into memory\n";
+        cerr << message;
+        throw message;
+    }
+    source = (const char *)data;
+
+    /* Old savefiles are text, and start with #Map. Those are read all at
+    once, and then the file isn't needed anymore. */
+    if (sourceSize >= 4 && memcmp(source, "#Map", 4) == 0) {
+        istringstream text(string(source, sourceSize));
+        munmap((void *)source, sourceSize);
+        source = nullptr;
+        sourceSize = 0;
+        loadText(text, filename);
+    }
+    else {
+        loadBinary(source, sourceSize, filename);
+    }
+}
+
+Map::~Map() {
+    finishSave();
+    delete lightWorkers;
+    /* Delete the map. */
+    for (unsigned int i = 0; i < chunks.size(); i++) {
+        delete chunks[i];
+    }
+    if (source) {
+        munmap((void *)source, sourceSize);
+    }
+    /* Delete each tile object. */
+    while (pointers.empty() == false) {
+        delete pointers.back();
+        pointers.pop_back();
+    }
+}
+
+size_t Map::getMemoryUsage() const {
+    size_t bytes = chunks.capacity() * sizeof(Chunk *);
+    for (unsigned int i = 0; i < chunks.size(); i++) {
+        if (chunks[i]) {
+            bytes += sizeof(Chunk);
         }
     }
+    bytes += biomes.capacity() * sizeof(BiomeInfo);
+    return bytes;
 }
 
 void Map::savePPM(MapLayer layer, std::string filename) {
@@ -661,12 +1303,14 @@ TileType Map::getTileType(int x, int y, MapLayer layer) const {
     if (!isOnMap(x, y)) {
         return TileType::EMPTY;
     }
+    int index;
+    Chunk *chunk = findChunk(x, y, index);
     if (layer == MapLayer::FOREGROUND) {
-        return findPointer(x, y) -> foreground;
+        return chunk -> foreground[index];
     }
     else {
         assert(layer == MapLayer::BACKGROUND);
-        return findPointer(x, y) -> background;
+        return chunk -> background[index];
     }
 }
 
@@ -676,27 +1320,44 @@ void Map::setTile(int x, int y, MapLayer layer, TileType val) {
 
     bool wasSky = isSky(x, y);
 
+    int index;
+    Chunk *chunk = findChunk(x, y, index);
     if (layer == MapLayer::FOREGROUND) {
-        findPointer(x, y) -> foreground = val;
+        chunk -> foreground[index] = val;
     }
     else if (layer == MapLayer::BACKGROUND) {
-        findPointer(x, y) -> background = val;
+        chunk -> background[index] = val;
     }
     else {
         /* We didn't change anything. */
         return;
     }
+    chunk -> dirty = true;
+    chunk -> renderVersion++;
+
+    /* Keep the sky height of this column up to date. If it hasn't been
+    worked out yet, it will be from the new tiles when it's needed. */
+    int column = wrapX(x);
+    if (skyHeights[column] < 0) {
+        // Pass
+    }
+    else if (!isSkyTile(column, y)) {
+        skyHeights[column] = max(skyHeights[column], y + 1);
+    }
+    else if (y == skyHeights[column] - 1) {
+        findSkyHeight(column, y);
+    }
 
     /* If we made it this far we changed something, so the amount of light
     reaching nearby tiles may have changed. */
     updateNear(x, y);
     if ((wasSky && !getTile(val) -> getIsSky())
             || getForeground(x, y) -> getEmitted() != Light(0, 0, 0, 0)) {
-        findPointer(x, y) -> lightRemoved = true;
+        chunk -> lightRemoved[index] = true;
     }
     if ((isSky(x, y) && !wasSky)
             || getTile(val) -> getEmitted() != Light(0, 0, 0, 0)) {
-        findPointer(x, y) -> lightAdded = true;
+        chunk -> lightAdded[index] = true;
     }
 }
 
@@ -729,6 +1390,14 @@ bool Map::placeTile(Location place, TileType type) {
 }
 
 void Map::update(vector<DroppedItem*> &items) {
+    /* See which tiles in newly loaded chunks need updating. Looking at them
+    can load more chunks, which will be checked next time. */
+    vector<int> loadedChunks;
+    loadedChunks.swap(newChunks);
+    for (unsigned int i = 0; i < loadedChunks.size(); i++) {
+        addChunkToUpdate(loadedChunks[i]);
+    }
+
     /* Make sure we're updating tiles that need to be updated. */
     set<Location>::iterator removeIter = toUpdate.begin();
     while (removeIter != toUpdate.end()) {
@@ -3,21 +3,142 @@
 
 #include <vector>
 #include <set>
+#include <bitset>
 #include <string>
 #include <algorithm>
+#include <thread>
+#include <atomic>
 #include "Tile.hh"
 #include "MapHelpers.hh"
+#include "MapFile.hh"
+#include "WorkerPool.hh"
 
+/* How much light can be absorbed before there's none left. It has to be
+less than 128 so that sums of two opacities packed into bytes don't
+overflow. */
 #define MAX_OPACITY 64
 
+/* Four opacities packed into a uint32_t, one byte per channel with r in the
+lowest byte and a in the highest, with MAX_OPACITY in every channel. */
+#define ALL_OPAQUE (MAX_OPACITY * 0x01010101u)
+
+/* What the light kernel puts where light doesn't get to. It can't be a
+packed opacity, since every channel of those is at most MAX_OPACITY. */
+#define UNLIT 0xFFFFFFFFu
+
+/* How many tiles away from its source light can reach. */
+#define MAX_LIGHT_DEPTH 5
+
+/* The width and height of the square of tiles a light source can reach, and
+how many tiles are in it. */
+#define LIGHT_GRID_SIZE (2 * MAX_LIGHT_DEPTH + 1)
+#define LIGHT_GRID_AREA (LIGHT_GRID_SIZE * LIGHT_GRID_SIZE)
+
 class DroppedItem;
 
 /* In the biome information stored, each piee refers to a square this size of
 tiles. */
 #define BIOME_SIZE 32
 
-/* A class for a map. Holds an array of SpaceInfos, which store the foreground
-and background tiles, among other things. */
+/* The map is stored, both in memory and in the savefile, in squares this size
+of tiles. It should be a multiple of BIOME_SIZE and a power of 2. */
+#define CHUNK_SIZE 64
+
+/* How many tiles are in a chunk. */
+#define CHUNK_AREA (CHUNK_SIZE * CHUNK_SIZE)
+
+/* The information about every tile in a CHUNK_SIZE square of the map. Each
+kind of information is in its own array, all indexed the same way (row by
+row), so that a loop that only needs one of them doesn't read the rest. */
+struct Chunk {
+    // The foreground and background objects
+    TileType foreground[CHUNK_AREA];
+    TileType background[CHUNK_AREA];
+
+    // Which rectangle of the spritesheet to draw
+    uint8_t foregroundSprite[CHUNK_AREA];
+    uint8_t backgroundSprite[CHUNK_AREA];
+
+    // How well-lit each tile is
+    Light light[CHUNK_AREA];
+
+    // Whether the light is actually set to the correct value
+    std::bitset<CHUNK_AREA> isLightUpdated;
+    // Whether light has been removed or added since then
+    std::bitset<CHUNK_AREA> lightRemoved;
+    std::bitset<CHUNK_AREA> lightAdded;
+
+    // Whether any tile or sprite has changed since the chunk was last saved
+    bool dirty;
+
+    /* Goes up whenever a tile or sprite changes, so that anything drawn from
+    the chunk can tell when to draw it again. Sprites of animated tiles don't
+    count, since those get drawn fresh every frame. */
+    unsigned int renderVersion;
+
+    // Constructor, which makes every tile empty
+    Chunk() {
+        dirty = false;
+        renderVersion = 0;
+        std::fill_n(foreground, CHUNK_AREA, TileType::EMPTY);
+        std::fill_n(background, CHUNK_AREA, TileType::EMPTY);
+        std::fill_n(foregroundSprite, CHUNK_AREA, 0);
+        std::fill_n(backgroundSprite, CHUNK_AREA, 0);
+    }
+};
+
+/* A copy of the parts of a Chunk that get saved. */
+struct SavedChunk {
+    TileType foreground[CHUNK_AREA];
+    TileType background[CHUNK_AREA];
+    uint8_t foregroundSprite[CHUNK_AREA];
+    uint8_t backgroundSprite[CHUNK_AREA];
+};
+
+/* Everything about a map that goes in a savefile, as it was at one moment.
+It can be written to a file on another thread while the map keeps
+changing. */
+class MapSnapshot {
+    friend class Map;
+
+    MapFileHeader header;
+    std::vector<BiomeInfo> biomes;
+
+    /* A copy of each loaded chunk, or nullptr for chunks that haven't been
+    loaded, which are copied straight from the old savefile. */
+    std::vector<SavedChunk *> chunks;
+
+    /* The memory-mapped old savefile, and where each chunk is in it. */
+    const char *source;
+    std::vector<ChunkRecord> records;
+
+    MapSnapshot() = default;
+
+public:
+    MapSnapshot(const MapSnapshot &) = delete;
+    MapSnapshot &operator=(const MapSnapshot &) = delete;
+
+    ~MapSnapshot();
+
+    /* Write the savefile. Return false if it couldn't be written. */
+    bool write(const std::string &filename) const;
+};
+
+/* How much work setLight has done, for profiling. */
+struct LightStats {
+    /* How many times it was called. */
+    long long calls;
+
+    /* How many tiles it checked for being light sources. */
+    long long tilesChecked;
+
+    /* How many tiles had their light cleared because a light source near
+    them went away. */
+    long long tilesCleared;
+};
+
+/* A class for a map. Holds Chunks, which store the foreground and background
+tiles, among other things. */
 class Map {
     /* Mapgen is basically an extra-fancy constructor. */
     friend class Mapgen;
@@ -31,8 +152,37 @@ class Map {
     /* How many ticks since the map was loaded. */
     unsigned int tick;
 
-    /* The array to hold the map info. This is a 2d array squished into 1d. */
-    SpaceInfo *tiles;
+    /* The chunk directory. Storing tiles in chunks means tiles above and
+    below each other are close together in memory. A chunk is nullptr until
+    it's read out of the savefile, which happens the first time findChunk is
+    asked for one of its tiles. Chunks on the top and right edges are full
+    size even though some of their tiles aren't on the map. */
+    mutable std::vector<Chunk *> chunks;
+
+    /* Chunks that have been loaded but whose tiles haven't been checked for
+    whether they need to be updated. */
+    mutable std::vector<int> newChunks;
+
+    /* The memory-mapped savefile the map was loaded from, or nullptr, and its
+    size in bytes. */
+    const char *source;
+    size_t sourceSize;
+
+    /* Where each chunk is in the savefile. */
+    std::vector<ChunkRecord> chunkRecords;
+
+    /* The binary savefile the map was loaded from or last saved to, which
+    autosaves can add chunks to, or an empty string if there isn't one. */
+    std::string savedFile;
+
+    /* How many chunks autosaves have added to the end of savedFile since it
+    was last fully saved. */
+    unsigned int appendedChunks;
+
+    /* The thread writing the last autosave or background save, or nullptr,
+    and whether it's still writing. */
+    std::thread *saveThread;
+    std::atomic<bool> isSaving;
 
     /* The array to hold the biome info. */
     std::vector<BiomeInfo> biomes;
@@ -41,12 +191,21 @@ class Map {
     collected because of the SDL textures. */
     std::vector<Tile *> pointers;
 
+    /* How much of each channel of light each type of tile absorbs in the
+    foreground and in the background, by TileType, packed the same way as
+    ALL_OPAQUE, so that spreading light doesn't have to ask the tiles. */
+    std::vector<uint32_t> foregroundOpacity;
+    std::vector<uint32_t> backgroundOpacity;
+
     /* The height and width of the map, in number of tiles. */
     int height, width;
 
     /* The height and width of the biome array. */
     int biomesHigh, biomesWide;
 
+    /* The height and width of the map, in number of chunks. */
+    int chunksHigh, chunksWide;
+
     /* Default spawn point. It may be possible for players to set their own
     spawn points later. */
     Location spawn;
@@ -62,17 +221,82 @@ private:
     /* Tiles that have been damaged. */
     std::vector<TileHealth> damaged;
 
-    /* Table of pre-calculated exponentials. */
-    std::vector<double> exps;
+    /* How much of a light is left after MAX_OPACITY or less of it has been
+    absorbed, in 256ths, for every amount. */
+    static const std::vector<uint16_t> falloff;
+
+    /* Work out what goes in falloff. */
+    static std::vector<uint16_t> makeFalloff();
+
+    /* The tiles setLight needs to check for light sources, one bit per tile
+    of the area it's working on, row by row. It's kept between calls so it
+    doesn't have to be allocated every frame. */
+    std::vector<uint64_t> toCheck;
+
+    /* The threads setLight splits its work over, or nullptr if it does
+    everything on the thread that calls it. */
+    WorkerPool *lightWorkers;
+
+    /* How much work setLight has done since the stats were last reset. */
+    LightStats lightStats;
+
+    /* For each column, one more than the y of the highest tile in it that
+    isn't sky, or 0 if every tile in it is sky. Everything at or above it is
+    sky. A column's is -1 until it's first needed, so that loading a map 
+    doesn't have to read every chunk above the ground. setTile keeps it up to
+    date, but setTileType doesn't. Mutable for the same reason chunks are. */
+    mutable std::vector<int> skyHeights;
+
+    /* The things that aren't tiles giving off light this frame. */
+    std::vector<Emitter> emitters;
+
+    /* The light from the emitters in the rectangle setDynamicLight was last
+    called with, row by row from the bottom left corner. It's kept apart from
+    the tiles' light, and getLight adds it on top, so that things that move
+    don't make the map get relit. */
+    std::vector<Light> dynamicLight;
+    int dynamicLeft, dynamicBottom, dynamicWidth, dynamicHeight;
+
+    /* Return the chunk x, y is in, which must already be loaded, and set
+    index to where x, y is in the chunk's arrays. */
+    inline Chunk *rawChunk(int x, int y, int &index) const {
+        assert(0 <= x);
+        assert(x < width);
+        assert(0 <= y);
+        assert(y < height);
+        Chunk *chunk = chunks[(y / CHUNK_SIZE) * chunksWide + x / CHUNK_SIZE];
+        assert(chunk != nullptr);
+        index = (y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE;
+        return chunk;
+    }
 
-    /* Return a pointer to the SpaceInfo* at x, y. */
-    inline SpaceInfo *findPointer(int x, int y) const {
+    /* Return the chunk x, y is in, loading it if necessary, and set index to
+    where x, y is in the chunk's arrays. */
+    inline Chunk *findChunk(int x, int y, int &index) const {
         x = wrapX(x);
         assert (0 <= y);
         assert (y < height);
-        return tiles + (y * width + x);
+        int chunk = (y / CHUNK_SIZE) * chunksWide + x / CHUNK_SIZE;
+        if (chunks[chunk] == nullptr) {
+            decodeChunk(chunk);
+        }
+        index = (y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE;
+        return chunks[chunk];
     }
 
+    /* Allocate the chunks and biomes for a map of the current size. Every
+    tile starts out empty. */
+    void allocate();
+
+    /* Read a chunk out of the savefile. This only fills in tiles that
+    haven't been looked at yet, so it's const for the same reason findChunk
+    is. */
+    void decodeChunk(int chunk) const;
+
+    /* Add every tile in a chunk that needs updating to the list of tiles to
+    update. */
+    void addChunkToUpdate(int chunk);
+
     /* Make a Tile object (or one of its subclasses), add it to the list of 
     pointers, and return a pointer to it. */
     Tile *newTile(TileType val);
@@ -99,19 +323,111 @@ private:
     Accept out-of-bounds x coordinates and loop them so they are in bounds. */
     bool isSky(int x, int y);
 
-    /* Spread out the light from a source at x, y. */
-    void effectLight(int x, int y, const Light &light, 
-        std::vector<std::vector<int>> &current);
-
-    /* Add an array for a light to the whole map. */
-    void addLight(int x, int y, std::vector<std::vector<int>> &current,
-        const Light &l);
+    /* Return true if both tiles at x, y are sky tiles, without using
+    skyHeights. x must be on the map. */
+    inline bool isSkyTile(int x, int y) const {
+        int index;
+        Chunk *chunk = findChunk(x, y, index);
+        return getTile(chunk -> foreground[index]) -> getIsSky()
+            && getTile(chunk -> background[index]) -> getIsSky();
+    }
+
+    /* Set the sky height of column x, given that every tile at or above
+    row start is sky, by looking down from there. */
+    void findSkyHeight(int x, int start) const;
+
+    /* Make sure the sky height of every column from xstart to xstop is 
+    worked out, so that it can be used from more than one thread. x can be
+    off the map and gets wrapped. */
+    void loadSkyHeights(int xstart, int xstop) const;
+
+    /* Set opacity to how much light each tile in the LIGHT_GRID_SIZE square
+    centered on x, y absorbs, with opacity[i * LIGHT_GRID_SIZE + j] being
+    the tile at x + i - MAX_LIGHT_DEPTH, y + j - MAX_LIGHT_DEPTH. Tiles off
+    the top or bottom of the map count as empty. */
+    void getOpacity(int x, int y, uint32_t *opacity);
+
+    /* Spread out the light from a source at x, y. Set current, which is
+    laid out like the opacity array, to how much of each channel has been
+    absorbed by the time the light gets to each tile, or UNLIT where it 
+    doesn't get to. */
+    void effectLight(int x, int y, uint32_t *current);
+
+    /* Return how much of a light is left after a packed amount of it has
+    been absorbed. */
+    static inline Light absorb(const Light &l, uint32_t absorbed) {
+        return Light(l.r * falloff[absorbed & 0xFF] >> 8, 
+            l.g * falloff[(absorbed >> 8) & 0xFF] >> 8,
+            l.b * falloff[(absorbed >> 16) & 0xFF] >> 8,
+            l.a * falloff[absorbed >> 24] >> 8);
+    }
+
+    /* Add the light from a source at x, y to the tiles it got to. */
+    void addLight(int x, int y, const uint32_t *current, const Light &l);
+
+    /* Set the bits for columns first through last of a row of toCheck. */
+    static void markColumns(uint64_t *row, int first, int last);
+
+    /* If the tile at x, y is a light source, spread its light. Sky tiles are
+    set to the sky's light, and spread it if they're next to a tile that
+    isn't sky. */
+    void checkLightSource(int x, int y);
+
+    /* Call checkLightSource on the tiles marked in rows first through 
+    last - 1 of toCheck, whose bottom row is the map's row bottom, and unmark
+    them. */
+    void checkLightRows(int first, int last, int bottom, int left, 
+        int rowWords);
+
+    /* Make sure every chunk with a tile in the rectangle is loaded, so that
+    it can be used from more than one thread. x can be off the map and gets
+    wrapped. */
+    void loadChunks(int xstart, int ystart, int xstop, int ystop) const;
 
 public:
+    /* Spread the light from a source at x, y onto the tiles around it. */
+    void spreadLight(int x, int y, const Light &light);
+
     /* Calculate how well-lit the tiles on screen are and set their light 
     levels. */
     void setLight(int xstart, int ystart, int xstop, int ystop);
 
+    /* Split the work of setLight over this many threads. 1 or less means
+    doing it all on the thread that calls setLight. The light comes out the
+    same either way. */
+    void setLightThreads(int threads);
+
+    /* Return how many threads setLight uses. */
+    inline int getLightThreads() const {
+        return lightWorkers ? lightWorkers -> getThreads() : 1;
+    }
+
+    /* Return how much work setLight has done since resetLightStats was
+    called. */
+    inline LightStats getLightStats() const {
+        return lightStats;
+    }
+
+    inline void resetLightStats() {
+        lightStats = {0, 0, 0};
+    }
+
+    /* Forget every emitter added since the last call. */
+    inline void clearEmitters() {
+        emitters.clear();
+    }
+
+    /* Add something at tile x, y that gives off light until clearEmitters
+    is called. */
+    inline void addEmitter(int x, int y, const Light &light) {
+        emitters.push_back({x, y, light});
+    }
+
+    /* Calculate how much light the emitters give to the tiles on screen.
+    Only the tiles near each emitter are looked at, so this can be done every
+    frame. */
+    void setDynamicLight(int xstart, int ystart, int xstop, int ystop);
+
 private:
     /* Set the tiles around a place to show the right sprite and have the
     right amount of light, and recheck if they need to run their own update
@@ -123,10 +439,12 @@ private:
     inline void setHeight(int newHeight) {
         height = newHeight;
         biomesHigh = height / BIOME_SIZE + 1;
+        chunksHigh = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
     }
     inline void setWidth(int newWidth) {
         width = newWidth;
         biomesWide = width / BIOME_SIZE + 1;
+        chunksWide = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
     }
 
     /* Get the biomeInfo of an x and y. */
@@ -191,16 +509,12 @@ private:
         return toUpdate.count(place);
     }
 
-    /* Calculates the coefficent for light when the opacity is n. */
-    inline double getExpLight(int n) {
-        if (n >= MAX_OPACITY) {
-            return 0;
-        }
-        if (exps[n] == 0) {
-            double coef = exp(-1 * n * n / (MAX_OPACITY * MAX_OPACITY / 4.0));
-            exps[n] = std::min(1.0, std::max(coef, 0.0));
-        }
-        return exps[n];
+    /* Return how much of a light is left after n of it has been absorbed,
+    in 256ths, for use with Light::scale. n can be at most MAX_OPACITY,
+    which leaves nothing. */
+    static inline unsigned int getFalloff(int n) {
+        assert(0 <= n && n <= MAX_OPACITY);
+        return falloff[n];
     }
 
     /* Return a number from 0-15 depending on which tiles border this one. 
@@ -213,18 +527,70 @@ private:
         return (x >= 0 && y >= 0 && x < width && y < height);
     }
 
-    /* Save the foreground or background layer to a file. */
-    void saveLayer(MapLayer layer, std::ofstream &outfile) const;
+private:
+    /* Decompress the chunk at chunkX, chunkY from the savefile data between
+    p and end. Return false if the data was bad. */
+    bool loadChunk(int chunkX, int chunkY, const char *p, 
+        const char *end) const;
 
-    /* Save the map to a file. */
-    void save(std::string filename) const;
+    /* Load the header, biomes, and chunk index of a binary savefile. The
+    chunks are left in the file until they're used. */
+    void loadBinary(const char *data, size_t size, 
+        const std::string &filename);
 
-    /* Read the foreground or background layer in from the savefile. */
-    void loadLayer(MapLayer layer, std::ifstream &infile);
+    /* Read the foreground or background layer in from an old text 
+    savefile. */
+    void loadLayer(MapLayer layer, std::istream &infile);
 
-    /* Constructor, from a savefile. */
+    /* Load the map from an old text savefile. */
+    void loadText(std::istream &infile, const std::string &filename);
+
+    /* Warn if the savefile was written by a different version. */
+    void checkVersion(int major, int minor, int patch) const;
+
+    /* Add the compressed chunks in data to the end of a savefile and point
+    the index entries of the chunks in indices at them. records says where in
+    data each chunk is. This runs on the save thread. */
+    static void appendChunks(std::string filename, std::string data, 
+        std::vector<int> indices, std::vector<ChunkRecord> records,
+        std::atomic<bool> *isSaving);
+
+    /* Write a snapshot and then delete it. This runs on the save thread. */
+    static void writeSnapshot(MapSnapshot *snapshot, std::string filename,
+        std::atomic<bool> *isSaving);
+
+    /* Copy everything that gets saved. Chunks that haven't been loaded stay
+    in the old savefile, which is mapped for as long as the map exists. */
+    MapSnapshot *takeSnapshot();
+
+public:
+    /* Save the map to a file. */
+    void save(std::string filename);
+
+    /* Save the map to a file on another thread. Only taking the snapshot
+    happens right away, and the map can keep changing while it's written. */
+    void saveInBackground(const std::string &filename);
+
+    /* Wait for anything being saved in the background to finish. */
+    void finishSave();
+
+    /* Save the chunks that have changed since the last save. The file is
+    written in the background, so this only takes as long as compressing the
+    changed chunks. If filename isn't a savefile this map can add chunks to,
+    or autosaves have made it much bigger than it needs to be, this does a
+    full save in the background instead. */
+    void autosave(const std::string &filename);
+
+    /* Constructor, from a savefile. The savefile is memory-mapped and each
+    chunk is only decompressed once something looks at it. Old text savefiles
+    can also be loaded (all at once), but the map will be saved in the binary
+    format. */
     Map(std::string filename, int tileWidth, int tileHeight, std::string p);
 
+    /* Return how many bytes the tiles, chunk directory, and biomes are
+    using. */
+    size_t getMemoryUsage() const;
+
     /* Save the specified layer to a PPM file. */
     void savePPM(MapLayer layer, std::string filename);
 
@@ -236,7 +602,17 @@ private:
 private:
     // Constructor. Resulting map cannot be played but can be saved.
     inline Map(std::string p) : TILE_WIDTH(1), TILE_HEIGHT(1) {
-        tiles = nullptr;
+        source = nullptr;
+        sourceSize = 0;
+        appendedChunks = 0;
+        saveThread = nullptr;
+        isSaving = false;
+        lightWorkers = nullptr;
+        resetLightStats();
+        dynamicLeft = 0;
+        dynamicBottom = 0;
+        dynamicWidth = 0;
+        dynamicHeight = 0;
         path = p;
 
         /* Create a tile object for each type. */
@@ -247,15 +623,7 @@ private:
 
 public:
     /* Destructor */
-    inline ~Map() {
-        /* Delete the map. */
-        delete[] tiles;
-        /* Delete each tile object. */
-        while (pointers.empty() == false) {
-            delete pointers.back();
-            pointers.pop_back();
-        }
-    }
+    ~Map();
 
     /* Return the height of the map, in number of tiles. */
     inline int getHeight() const {
@@ -284,11 +652,15 @@ public:
 
     /* Return which part of the spritesheet should be used. */
     inline uint8_t getForegroundSprite(int x, int y) const {
-        return findPointer(x, y) -> foregroundSprite;
+        int index;
+        Chunk *chunk = findChunk(x, y, index);
+        return chunk -> foregroundSprite[index];
     }
 
     inline uint8_t getBackgroundSprite(int x, int y) const {
-        return findPointer(x, y) -> backgroundSprite;
+        int index;
+        Chunk *chunk = findChunk(x, y, index);
+        return chunk -> backgroundSprite[index];
     }
 
     inline Location getSprite(int x, int y, MapLayer layer) const {
@@ -302,7 +674,7 @@ public:
         }
 
         Location answer;
-        SpaceInfo::fromSpritePlace(answer, sprite);
+        SpritePlace::fromSpritePlace(answer, sprite);
         return answer;
     }
 
@@ -312,13 +684,19 @@ public:
 
     /* Set which part of the spritesheet should be used. */
     inline void setSprite(int x, int y, MapLayer layer, Location newSprite) {
-        uint8_t toset = SpaceInfo::toSpritePlace(newSprite);
+        uint8_t toset = SpritePlace::toSpritePlace(newSprite);
+        int index;
+        Chunk *chunk = findChunk(x, y, index);
         if (layer == MapLayer::FOREGROUND) {
-            findPointer(x, y) -> foregroundSprite = toset;
+            chunk -> foregroundSprite[index] = toset;
         }
         else {
             assert(layer == MapLayer::BACKGROUND);
-            findPointer(x, y) -> backgroundSprite = toset;
+            chunk -> backgroundSprite[index] = toset;
+        }
+        chunk -> dirty = true;
+        if (!getTile(x, y, layer) -> getIsAnimated()) {
+            chunk -> renderVersion++;
         }
     }
 
@@ -326,11 +704,27 @@ public:
         setSprite(place.x, place.y, place.layer, newSprite);
     }  
 
+    /* Return a number that changes whenever a tile or sprite in the chunk
+    x, y is in changes, apart from animated tiles' sprites. */
+    inline unsigned int getRenderVersion(int x, int y) const {
+        int index;
+        return findChunk(x, y, index) -> renderVersion;
+    }
+
     /* Return the lighting of a tile. */
     inline Light getLight(int x, int y) {
         /* Combine the value from blocks with the value from the sky, taking into
         account that the color of light the sky makes. */
-        return findPointer(x, y) -> light.useSky(getSkyLight());
+        int index;
+        Chunk *chunk = findChunk(x, y, index);
+        Light light = chunk -> light[index];
+        /* Add the light from the emitters. */
+        int dx = wrapX(x - dynamicLeft);
+        int dy = y - dynamicBottom;
+        if (dx < dynamicWidth && 0 <= dy && dy < dynamicHeight) {
+            light.setmax(dynamicLight[dy * dynamicWidth + dx]);
+        }
+        return light.useSky(getSkyLight());
     }
 
     /* Return the color the sun / moon is shining. */
@@ -338,6 +732,16 @@ public:
         return {255, 255, 255, 255};
     }
 
+    /* Return the lowest row of column x with nothing but sky from there up,
+    so x, y is open to the sky exactly when y is at least this. */
+    inline int getSkyHeight(int x) const {
+        x = wrapX(x);
+        if (skyHeights[x] < 0) {
+            findSkyHeight(x, height);
+        }
+        return skyHeights[x];
+    }
+
     /* Return the color the sky tiles should be rendered. */
     inline Light getSkyColor() const {
         return {0x00, 0x99, 0xFF, 0xFF};
@@ -355,13 +759,17 @@ public:
     /* Returns the foreground tile pointer at x, y.
     0, 0 is the bottom right. */
     inline Tile *getForeground(int x, int y) {
-        return getTile(findPointer(x, y) -> foreground);
+        int index;
+        Chunk *chunk = findChunk(x, y, index);
+        return getTile(chunk -> foreground[index]);
     }
 
     /* Returns the background tile pointer at x, y.
     0, 0 is the bottom right. */
     inline Tile *getBackground(int x, int y) {
-        return getTile(findPointer(x, y) -> background);
+        int index;
+        Chunk *chunk = findChunk(x, y, index);
+        return getTile(chunk -> background[index]);
     }
 
     /* Get the type of the tile at x, y, layer. If it isn't on the map,
@@ -371,13 +779,17 @@ public:
     /* Sets the tiletype very fast (does not update the sprites of the tiles
     around it). */
     inline void setTileType(int x, int y, MapLayer layer, TileType type) {
+        int index;
+        Chunk *chunk = findChunk(x, y, index);
         if (layer == MapLayer::FOREGROUND) {
-            findPointer(x, y) -> foreground = type;
+            chunk -> foreground[index] = type;
         }
         else {
             assert(layer == MapLayer::BACKGROUND);
-            findPointer(x, y) -> background = type;
+            chunk -> background[index] = type;
         }
+        chunk -> dirty = true;
+        chunk -> renderVersion++;
     }
 
     /* Get the type of the tile at place.x + x, place.y + y, place.layer. 
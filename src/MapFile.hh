@@ -0,0 +1,196 @@
+#ifndef MAPFILE_HH
+#define MAPFILE_HH
+
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cassert>
+
+/* The binary save format for maps. A savefile is a MapFileHeader, then an
+index with a ChunkRecord for every chunk (row by row, starting at y = 0), then
+the biome section, then the chunks themselves. Every number is written in the
+machine's byte order, which is little-endian on everything this runs on.
+
+Each chunk holds the foreground, background, foreground sprite, and
+background sprite layers of a CHUNK_SIZE square of tiles, in that order. Each
+layer is run-length encoded as a uint32_t number of runs followed by that many
+fixed-size runs, which are a uint32_t count and then the value. The biome
+section is encoded the same way.
+
+Autosaves add the chunks that changed to the end of the file and then point
+their index entries at the new copies, so chunks can be in any order and there
+can be old copies nothing points to. A full save writes a fresh file without
+them. */
+
+/* The first bytes of a binary savefile. Old text savefiles start with #Map. */
+#define MAP_FILE_MAGIC "BURROWBN"
+#define MAP_FILE_MAGIC_SIZE 8
+
+/* Increase this whenever the layout of the binary format changes. */
+#define MAP_FILE_VERSION 1
+
+/* Everything needed to make sense of the rest of the file. */
+struct MapFileHeader {
+    char magic[MAP_FILE_MAGIC_SIZE];
+    uint32_t formatVersion;
+
+    /* Version of the game that wrote the file. */
+    uint32_t major;
+    uint32_t minor;
+    uint32_t patch;
+
+    int32_t width;
+    int32_t height;
+    int32_t spawnX;
+    int32_t spawnY;
+    int32_t seed;
+
+    uint32_t chunkSize;
+    uint32_t chunksWide;
+    uint32_t chunksHigh;
+    uint32_t biomesWide;
+    uint32_t biomesHigh;
+
+    /* Where in the file the biome section is, and how many bytes long. */
+    uint64_t biomeOffset;
+    uint64_t biomeSize;
+};
+
+/* Where in the file a chunk is, and how many bytes long. */
+struct ChunkRecord {
+    uint64_t offset;
+    uint64_t size;
+};
+
+namespace MapFile {
+    /* Append the bytes of a value to the end of a buffer. */
+    template<class T>
+    inline void writeValue(std::string &out, const T &value) {
+        out.append((const char *)&value, sizeof(T));
+    }
+
+    /* Overwrite the bytes at offset with a value. */
+    template<class T>
+    inline void writeValueAt(std::string &out, size_t offset, const T &value) {
+        assert(offset + sizeof(T) <= out.size());
+        memcpy(&out[offset], &value, sizeof(T));
+    }
+
+    /* Read a value and move p past it. Return false if that would read past
+    the end. */
+    template<class T>
+    inline bool readValue(const char *&p, const char *end, T &value) {
+        if (end - p < (long)sizeof(T)) {
+            return false;
+        }
+        memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+
+    /* Return how many of the n values starting at p are equal to value.
+    While the run lasts, 8 bytes of values are compared at once. */
+    template<class T>
+    inline int runLength(const T *p, int n, T value) {
+        static_assert(sizeof(uint64_t) % sizeof(T) == 0, 
+            "Values must fit evenly in a uint64_t");
+        const int perWord = sizeof(uint64_t) / sizeof(T);
+        T values[perWord];
+        std::fill_n(values, perWord, value);
+        uint64_t pattern;
+        memcpy(&pattern, values, sizeof(pattern));
+
+        int i = 0;
+        while (i + perWord <= n) {
+            uint64_t word;
+            memcpy(&word, p + i, sizeof(word));
+            if (word != pattern) {
+                break;
+            }
+            i += perWord;
+        }
+        while (i < n && p[i] == value) {
+            i++;
+        }
+        return i;
+    }
+
+    /* Run-length encode a layer w values wide and h tall, where row r
+    starts at data + r * stride, and append it to out. Runs can continue
+    from the end of one row to the start of the next. This is used for every
+    layer of every chunk and for the biomes. */
+    template<class T>
+    void encodeLayer(std::string &out, const T *data, int w, int h, 
+            int stride) {
+        /* Leave space for the number of runs. */
+        size_t start = out.size();
+        writeValue(out, (uint32_t)0);
+        if (w <= 0 || h <= 0) {
+            return;
+        }
+
+        uint32_t runs = 0;
+        T value = data[0];
+        uint32_t count = 0;
+        for (int r = 0; r < h; r++) {
+            const T *row = data + r * stride;
+            int i = 0;
+            while (i < w) {
+                if (row[i] != value) {
+                    writeValue(out, count);
+                    writeValue(out, value);
+                    runs++;
+                    value = row[i];
+                    count = 0;
+                }
+                int length = runLength(row + i, w - i, value);
+                count += length;
+                i += length;
+            }
+        }
+        writeValue(out, count);
+        writeValue(out, value);
+        runs++;
+        writeValueAt(out, start, runs);
+    }
+
+    /* Decode a layer written by encodeLayer into a w by h block starting
+    at data, where row r starts at data + r * stride, and move p past it.
+    Return false if the data is truncated or doesn't have exactly w * h
+    values. */
+    template<class T>
+    bool decodeLayer(const char *&p, const char *end, T *data, int w, int h,
+            int stride) {
+        uint32_t runs;
+        if (!readValue(p, end, runs)) {
+            return false;
+        }
+        long left = (long)w * h;
+        int r = 0;
+        int c = 0;
+        for (uint32_t k = 0; k < runs; k++) {
+            uint32_t count;
+            T value;
+            if (!readValue(p, end, count) || !readValue(p, end, value)
+                    || (long)count > left) {
+                return false;
+            }
+            left -= count;
+            /* Fill in the run a row at a time. */
+            while (count > 0) {
+                int length = std::min((uint32_t)(w - c), count);
+                std::fill_n(data + r * stride + c, length, value);
+                count -= length;
+                c += length;
+                if (c == w) {
+                    c = 0;
+                    r++;
+                }
+            }
+        }
+        return left == 0;
+    }
+}
+
+#endif
@@ -34,6 +34,14 @@ struct TileHealth {
     int lastUpdated;
 };
 
+/* Something that isn't a tile giving off light, like a held torch, and the
+tile it's in. */
+struct Emitter {
+    int x;
+    int y;
+    Light light;
+};
+
 /* A class for passing a global-biome argument, to pick which pattern of 
 world-generation to use. */
 enum class WorldType {
@@ -91,40 +99,9 @@ struct BiomeInfo {
     BiomeType biome;
 };
 
-/* A struct that holds information about a specific tile location on the map.
-It has pointers to the foreground object (blocks, furniture, trees), the 
-background object (walls), and the liquid. It also has ints for the health of
-the foreground and background objects, where 'health' is roughly equivalent to
-the number of times it can be hit with a pickax before it breaks. */
-struct SpaceInfo {
-    // The foreground and background objects
-    TileType foreground;
-    TileType background;
-
-    // How well-lit this tile is, and from where
-    Light light;
-    Light sunlight;
-
-    // Whether the light is actually set to the correct value
-    bool isLightUpdated;
-    bool lightRemoved;
-    bool lightAdded;
-
-    // Which rectangle of the spritesheet to draw
-    uint8_t foregroundSprite;
-    uint8_t backgroundSprite;
-
-    // Constructor
-    SpaceInfo() {
-        foreground = TileType::EMPTY;
-        background = TileType::EMPTY;
-        isLightUpdated = false;
-        lightRemoved = false;
-        lightAdded = false;
-        foregroundSprite = 0;
-        backgroundSprite = 0;
-    }
-
+/* Functions to convert between a place on a spritesheet and the byte the map
+stores it as. */
+struct SpritePlace {
     static inline void fromSpritePlace(Location &place, uint8_t spritePlace) {
         place.x = spritePlace / 16;
         place.y = spritePlace % 16;
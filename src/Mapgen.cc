@@ -15,9 +15,7 @@ using json = nlohmann::json;
 void Mapgen::setSize(int x, int y) {
     map.setHeight(y);
     map.setWidth(x);
-    map.biomes.resize(map.biomesWide * map.biomesHigh);
-    assert(map.tiles == nullptr);
-    map.tiles = new SpaceInfo[map.width * map.height];
+    map.allocate();
     cylinderScale.SetXScale((map.width / 2.0) / M_PI);
     cylinderScale.SetZScale(cylinderScale.GetXScale());
 }
@@ -6,6 +6,7 @@
 #include <iostream>
 #include "filepaths.hh"
 #include "Renderer.hh"
+#include "AssetBundle.hh"
 
 using namespace std;
 using json = nlohmann::json;
@@ -38,6 +39,10 @@ Movable::Movable() {
     maxHeight = 0;
     boulderSpeed = 0;
 
+    lastX = 0;
+    lastY = 0;
+    hasLastPosition = false;
+
     // These should be changed by the child class's init.
     drag.x = 0;
     drag.y = 0;
@@ -52,11 +57,7 @@ Movable::Movable() {
 
 /* Constructor from json file. */
 Movable::Movable(std::string filename) {
-    /* open file */
-    ifstream infile(filename);
-    /* Put data in json. */
-    json j = json::parse(infile);
-    *this = j.get<Movable>();
+    *this = AssetBundle::getJson(filename).get<Movable>();
 }
 
 /* Copy constructor. */
@@ -71,6 +72,9 @@ Movable &Movable::operator=(const Movable &movable) {
     }
     rect = movable.rect;
     nextRect = movable.nextRect;
+    lastX = movable.lastX;
+    lastY = movable.lastY;
+    hasLastPosition = movable.hasLastPosition;
     drag = movable.drag;
     velocity = movable.velocity;
     accel = movable.accel;
@@ -89,6 +93,7 @@ Movable &Movable::operator=(const Movable &movable) {
     maxHeight = movable.maxHeight;
     minVelocity = movable.minVelocity;
     boulderSpeed = movable.boulderSpeed;
+    emitted = movable.emitted;
     return *this;
 }
 
@@ -172,13 +177,48 @@ void Movable::takeDamage(const Damage &damage) {}
 /* Take fall damage. Does nothing. */
 void Movable::takeFallDamage() {}
 
+Light Movable::getEmitted() const {
+    return emitted;
+}
+
 /* Convert a rectangle from world coordinates to screen coordinates. */
 void Movable::convertRect(SDL_Rect &rect, const Rect &camera) {
     rect.x = (rect.x - camera.x + camera.worldWidth) % camera.worldWidth;
     rect.y = camera.y + camera.h - rect.y - rect.h;
 }
 
-void Movable::render(const Rect &camera) {}
+void Movable::savePosition() {
+    lastX = rect.x;
+    lastY = rect.y;
+    hasLastPosition = true;
+}
+
+Rect Movable::getRenderRect(double alpha) const {
+    if (!hasLastPosition) {
+        return rect;
+    }
+    alpha = std::min(1.0, std::max(0.0, alpha));
+    int dx = rect.x - lastX;
+    int dy = rect.y - lastY;
+    Rect r = rect;
+    if (rect.worldWidth > 0) {
+        /* Go the short way if it crossed the edge of the world. */
+        if (dx > rect.worldWidth / 2) {
+            dx -= rect.worldWidth;
+        }
+        else if (dx < -rect.worldWidth / 2) {
+            dx += rect.worldWidth;
+        }
+    }
+    r.x = rect.x - (int)lround(dx * (1 - alpha));
+    r.y = rect.y - (int)lround(dy * (1 - alpha));
+    if (rect.worldWidth > 0) {
+        r.x = (r.x % rect.worldWidth + rect.worldWidth) % rect.worldWidth;
+    }
+    return r;
+}
+
+void Movable::render(const Rect &camera, double alpha) {}
 
 int Movable::getWidth() const {
     return rect.w;
@@ -262,6 +302,11 @@ void from_json(const json &j, Movable &movable) {
     movable.rect.x = j["x"];
     movable.rect.y = j["y"];
     movable.boulderSpeed = 0;
+    /* Most things don't give off light, so leaving it out means none. */
+    movable.emitted = Light();
+    if (j.count("emitted")) {
+        movable.emitted = j["emitted"].get<Light>();
+    }
 }
 
 } // End namespace movable
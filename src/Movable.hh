@@ -30,6 +30,11 @@ protected:
     /* For attempting to change collision rect size. */
     Rect nextRect;
 
+    /* Where it was at the start of the last update, so that it can be drawn
+    partway between there and where it is now. */
+    int lastX, lastY;
+    bool hasLastPosition;
+
 public:
     /* Access functions. */
     inline void setX(int x) {
@@ -82,6 +87,9 @@ public:
     /* How fast are all the boulders trying to move it this update. */
     int boulderSpeed;
 
+    /* The light it gives off. */
+    Light emitted;
+
     // Constructor
     Movable();
 
@@ -131,13 +139,24 @@ public:
     /* Take fall damage. Also does nothing unless the movables is an entity. */
     virtual void takeFallDamage();
 
+    /* Return the light it gives off. */
+    virtual Light getEmitted() const;
+
     /* Convert a rectangle from world coordinates to screen coordinates. */
     static void convertRect(SDL_Rect &rect, const Rect &camera);
 
+    /* Remember where it is, before an update moves it. */
+    void savePosition();
+
+    /* Get the collision rect as it should be drawn, alpha of the way from
+    where it was before the last update to where it is now. */
+    Rect getRenderRect(double alpha) const;
+
     /* Render itself to the screen, given a Rect that tells it where the
-    screen is in the world. Since Movables don't have sprites, this is just
-    here to be virtual. */
-    virtual void render(const Rect &camera);
+    screen is in the world, and how far it is between the last update and 
+    the next one. Since Movables don't have sprites, this is just here to be
+    virtual. */
+    virtual void render(const Rect &camera, double alpha);
 
     /* Get height and width, defined by height and width of the sprite. */
     virtual int getWidth() const;
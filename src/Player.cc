@@ -6,6 +6,7 @@
 #include "Action.hh"
 #include <iostream>
 #include "json.hh"
+#include "AssetBundle.hh"
 #include "filepaths.hh"
 #include "DroppedItem.hh"
 
@@ -19,12 +20,8 @@ Player::Player(string path) : Entity(path + "entities/bunny.json", path),
         inventory(12, 5, path), trash(1, 1, path, true), hotbar(path) {
     hasInventory = true;
 
-    /* Open json file that contains info about the stat bars. */
-    ifstream bar_infile(path + "UI/stat_bars.json");
-    if (!bar_infile) {
-        cerr << "Can't open " << path + "UI/stat_bars.json" << "\n";
-    }
-    json jstats = json::parse(bar_infile);
+    /* Get the json file that contains info about the stat bars. */
+    const json &jstats = AssetBundle::getJson(path + "UI/stat_bars.json");
 
     healthBar = jstats["healthBar"].get<StatBar>();
     fullnessBar = jstats["fullnessBar"].get<StatBar>();
@@ -40,11 +37,7 @@ Player::Player(string path) : Entity(path + "entities/bunny.json", path),
     fullnessBar.overlay.loadTexture(path + UI_SPRITE_PATH);
     manaBar.overlay.loadTexture(path + UI_SPRITE_PATH);
 
-    ifstream infile(path + "entities/bunny.json");
-    if (!infile) {
-        cerr << "Can't open " << path + "entities/bunny.json" << "!\n";
-    }
-    json j = json::parse(infile);
+    const json &j = AssetBundle::getJson(path + "entities/bunny.json");
 
     tileReachUp = j["tileReachUp"];
     tileReachDown = j["tileReachDown"];
@@ -145,6 +138,16 @@ bool Player::canUse() {
     return useTimeLeft == 0;
 }
 
+Light Player::getEmitted() const {
+    /* The item the mouse is holding is the one that gets used, so it's the
+    one being held. */
+    Action *held = mouseSlot ? mouseSlot : hotbar.getSelected();
+    if (held && held -> isItem()) {
+        return Entity::getEmitted().max(((Item *)held) -> getEmitted());
+    }
+    return Entity::getEmitted();
+}
+
 // Use the item or skill held or selected
 void Player::useAction(InputType type, int x, int y, World &world) {
     // Only bother if we actually can
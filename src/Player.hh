@@ -78,6 +78,9 @@ public:
     // Try to pick up an item
     virtual void pickup(DroppedItem *item);
 
+    /* Give off light if the item being held does. */
+    virtual Light getEmitted() const;
+
     /* Drop the items the mouse is holding to the ground and add it to the 
     vector. */
     inline void toss(std::vector<DroppedItem *> &drops) {
@@ -1,5 +1,61 @@
 #include "Renderer.hh"
 
+using namespace std;
+
 /* Initialize the static value. */
 std::mutex Renderer::m;
 SDL_Renderer *Renderer::renderer = NULL;
+std::thread::id Renderer::renderThread;
+std::vector<std::function<void()>> Renderer::queued;
+unsigned long Renderer::queuedCount = 0;
+unsigned long Renderer::finishedCount = 0;
+std::condition_variable Renderer::finished;
+
+bool Renderer::isRenderThread() {
+    lock_guard<mutex> lock(m);
+    return renderThread == thread::id() 
+        || renderThread == this_thread::get_id();
+}
+
+void Renderer::run(const function<void()> &job) {
+    if (isRenderThread()) {
+        job();
+        return;
+    }
+    unique_lock<mutex> lock(m);
+    queued.push_back(job);
+    queuedCount++;
+    unsigned long ticket = queuedCount;
+    finished.wait(lock, [&]() {
+        return finishedCount >= ticket;
+    });
+}
+
+void Renderer::post(const function<void()> &job) {
+    if (isRenderThread()) {
+        job();
+        return;
+    }
+    lock_guard<mutex> lock(m);
+    queued.push_back(job);
+    queuedCount++;
+}
+
+void Renderer::doQueued() {
+    vector<function<void()>> jobs;
+    {
+        lock_guard<mutex> lock(m);
+        jobs.swap(queued);
+    }
+    /* Do them without the lock, since they might take a while. They're in
+    the order they were queued, so finishing them in order is enough for a
+    waiting thread to tell when its job is done. */
+    for (unsigned int i = 0; i < jobs.size(); i++) {
+        jobs[i]();
+        lock_guard<mutex> lock(m);
+        finishedCount++;
+    }
+    if (!jobs.empty()) {
+        finished.notify_all();
+    }
+}
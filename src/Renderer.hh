@@ -4,64 +4,86 @@
 #include <SDL2/SDL.h>
 #include "Light.hh"
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <vector>
 
 /* A class to hold the renderer. This exists because it's probably slightly
-better than just making the renderer global. */
+better than just making the renderer global. 
+
+Only the thread that made the renderer calls SDL's rendering functions, so
+drawing doesn't need any locks. Other threads, like the one making a new
+world, hand anything that needs the renderer to it with run or post, and the
+render thread does it the next time it calls doQueued. */
 class Renderer {
     friend class Texture;
     friend class WindowHandler;
-    static std::mutex m;
     static SDL_Renderer *renderer;
 
+    /* The thread that made the renderer. */
+    static std::thread::id renderThread;
+
+    /* For access to queued and finished. */
+    static std::mutex m;
+
+    /* Jobs other threads want done on the render thread, in order. */
+    static std::vector<std::function<void()>> queued;
+
+    /* How many jobs have been queued and how many have been finished, so a
+    thread waiting on one can tell when it's done. */
+    static unsigned long queuedCount;
+    static unsigned long finishedCount;
+    static std::condition_variable finished;
+
 public:
+    /* Return whether this thread can call SDL's rendering functions. Before
+    there's a renderer, any thread can. */
+    static bool isRenderThread();
+
+    /* Do job on the render thread, and wait for it to be done. */
+    static void run(const std::function<void()> &job);
+
+    /* Do job on the render thread, without waiting for it. */
+    static void post(const std::function<void()> &job);
+
+    /* Do all the jobs other threads have asked for. The render thread should
+    call this once a frame. */
+    static void doQueued();
 
     /* Set the render draw color to a light, but with full alpha. */
     inline static void setColor(const Light &color) {
-        m.lock();
         SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 0xFF);
-        m.unlock();
     }
 
     /* Set the render draw color. */
     inline static void setColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
-        m.lock();
         SDL_SetRenderDrawColor(renderer, r, g, b, a);
-        m.unlock();
     }
 
     /* Set the render draw color to white. */
     inline static void setColorWhite() {
-        m.lock();
         SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-        m.unlock();
     }
 
     /* Render a rectangle. */
     inline static void renderFillRect(const SDL_Rect &rect) {
-        m.lock();
         SDL_RenderFillRect(renderer, &rect);
-        m.unlock();
     }
 
     /* Clear render target with drawing color. */
     inline static void renderClear() {
-        m.lock();
         SDL_RenderClear(renderer);
-        m.unlock();
     }
 
     /* Clear render target with drawing color. */
     inline static void setTarget(SDL_Texture *target) {
-        m.lock();
         SDL_SetRenderTarget(renderer, target);
-        m.unlock();
     }
 
     /* Put the rendered stuff on the screen. */
     inline static void renderPresent() {
-        m.lock();
         SDL_RenderPresent(renderer);
-        m.unlock();
     }
 
 };
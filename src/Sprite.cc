@@ -24,6 +24,10 @@ void Sprite::render(const SDL_Rect &rectTo) {
     SpriteBase::render(rect, rectTo);
 }
 
+void Sprite::render(const SDL_Rect &rectTo) const {
+    SpriteBase::render(rect, rectTo);
+}
+
 int Sprite::getWidth() const {
     return rect.w;
 }
@@ -66,6 +66,10 @@ public:
     /* Render itself. */
     virtual void render(const SDL_Rect &rectTo);
 
+    /* Render itself, for sprites that are shared and can't be changed. A
+    Sprite doesn't change when it's rendered anyway. */
+    void render(const SDL_Rect &rectTo) const;
+
     /* Use a different part of the spritesheet. */
     inline void move(int x, int y) {
         rect.x = x;
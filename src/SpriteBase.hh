@@ -11,7 +11,8 @@ protected:
     Light color;
 
     /* Render, using the color. Public render functions should call this. */
-    inline void render(const SDL_Rect &rectFrom, const SDL_Rect &rectTo) {
+    inline void render(const SDL_Rect &rectFrom, const SDL_Rect &rectTo) 
+            const {
         if (hasTexture()) {
             texture -> SetTextureColorMod(color);
             texture -> SetTextureAlphaMod(color.a);
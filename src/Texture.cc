@@ -10,11 +10,14 @@ using namespace std;
 
 /* Declare static variables. */
 std::mutex Texture::m;
-std::vector<LoadedTexture> Texture::loaded;
-std::vector<LoadedFont> Texture::fonts;
+std::unordered_map<SDL_Texture *, LoadedTexture> Texture::loaded;
+std::unordered_map<std::string, SDL_Texture *> Texture::named;
+std::unordered_map<FontKey, TTF_Font *, FontKeyHash> Texture::fonts;
+CacheStats Texture::textureStats = {0, 0, 0};
+CacheStats Texture::fontStats = {0, 0, 0};
 
 
-SDL_Texture *Texture::getText(string text, int size, 
+SDL_Surface *Texture::getText(string text, int size, 
         int outline_size, Light color, Light outline_color, int wrap_length) {
     TTF_Font *font = getFont(FONT_NAME, size, 0);
     TTF_Font *font_outline = getFont(FONT_NAME, size, outline_size);
@@ -47,23 +50,33 @@ SDL_Texture *Texture::getText(string text, int size,
         SDL_FreeSurface(fg_surface); 
     }
 
-    // Create and return texture from surface
-    Renderer::m.lock();
-    SDL_Texture *answer = SDL_CreateTextureFromSurface(Renderer::renderer, 
-        bg_surface);
-    Renderer::m.unlock();
-    SDL_FreeSurface(bg_surface);
-    return answer;   
+    return bg_surface;
+}
+
+SDL_Texture *Texture::createTexture(SDL_Surface *surface) {
+    SDL_Texture *answer = nullptr;
+    Renderer::run([&]() {
+        answer = SDL_CreateTextureFromSurface(Renderer::renderer, surface);
+    });
+    return answer;
+}
+
+void Texture::destroyTexture(SDL_Texture *texture) {
+    Renderer::post([texture]() {
+        SDL_DestroyTexture(texture);
+    });
 }
 
 TTF_Font *Texture::getFont(string name, int size, int outline) {
-    for (unsigned int i = 0; i < fonts.size(); i++) {
-        if (fonts[i].name == name && fonts[i].size == size 
-                && fonts[i].outline == outline) {
-            return fonts[i].font;
-        }
+    FontKey key = {name, size, outline};
+    fontStats.lookups++;
+    auto found = fonts.find(key);
+    if (found != fonts.end()) {
+        fontStats.hits++;
+        return found->second;
     }
     /* Font not found. Try loading one. */
+    fontStats.misses++;
     string fontfile = getPath() + FONT_FILE_PATH + name;
     TTF_Font *font = TTF_OpenFont((fontfile).c_str(), size);
     if (outline) {
@@ -76,17 +89,19 @@ TTF_Font *Texture::getFont(string name, int size, int outline) {
         throw message;
     }
     
-    fonts.push_back({font, name, size, outline});
+    fonts[key] = font;
     return font;
 }
 
 void Texture::addToLoaded() {
+    if (!texture) {
+        return;
+    }
     /* Check if it's in the list of loaded textures. */
-    for (unsigned int i = 0; i < loaded.size(); i++) {
-        if (loaded[i].texture == texture) {
-            loaded[i].count++;
-            return;
-        }
+    auto found = loaded.find(texture);
+    if (found != loaded.end()) {
+        found->second.count++;
+        return;
     }
 
     /* Otherwise, add it to the list. */
@@ -94,66 +109,91 @@ void Texture::addToLoaded() {
     newTexture.name = "";
     newTexture.texture = texture;
     newTexture.count = 1;
-    loaded.push_back(newTexture);
+    loaded[texture] = newTexture;
+}
+
+void Texture::removeFromLoaded() {
+    if (!texture) {
+        return;
+    }
+    auto found = loaded.find(texture);
+    /* If it wasn't in the list, it should just be destroyed. */
+    if (found == loaded.end()) {
+        destroyTexture(texture);
+        return;
+    }
+    found->second.count--;
+    assert(found->second.count >= 0);
+    /* If there aren't any textures left, free the memory. */
+    if (found->second.count == 0) {
+        if (found->second.name != "") {
+            named.erase(found->second.name);
+        }
+        loaded.erase(found);
+        destroyTexture(texture);
+    }
 }
 
 Texture::Texture(const std::string &name) {
     texture = nullptr;
-    m.lock();
-    Renderer::m.lock();
     assert(Renderer::renderer != nullptr);
-    Renderer::m.unlock();
     assert(name != "");
 
     /* Check if a texture with that name has already been loaded. */
-    for (unsigned int i = 0; i < loaded.size(); i++) {
-        if (loaded[i].name == name) {
+    {
+        lock_guard<mutex> lock(m);
+        textureStats.lookups++;
+        auto found = named.find(name);
+        if (found != named.end()) {
             /* Found the texture already loaded, so we copy it, add to
             the reference count, and return. */
-            texture = loaded[i].texture;
-            loaded[i].count++;
-            m.unlock();
+            textureStats.hits++;
+            texture = found->second;
+            loaded[texture].count++;
             return;
         }
+        textureStats.misses++;
     }
 
-    /* It wasn't already loaded. */
-    /* Load a surface. */
+    /* It wasn't already loaded. Load it without holding the lock, since 
+    making the texture might mean waiting for the render thread. */
     SDL_Surface *surface = IMG_Load(name.c_str());
     if (surface == nullptr) {
         string message = (string)"Failed to load image with filename " + name 
         + (string)"\nSDL_Error: " + SDL_GetError() + "\n";
         cerr << message;
-        m.unlock();
         throw message;
     }
-    /* Make a texture. */
-    else {
-        // Convert the surface to a texture
-        Renderer::m.lock();
-        texture = SDL_CreateTextureFromSurface(Renderer::renderer, surface);
-        Renderer::m.unlock();
-        // Get rid of the surface
-        SDL_FreeSurface(surface);
-
-        if (texture == nullptr) {
-            string message = (string)"Failed to convert surface to texture!"
-                + (string)" Surface loaded from " + name + "\nSDL_Error: " 
-                + SDL_GetError() + "\n";
-            cerr << message;
-            m.unlock();
-            throw message;
-        }
+    // Convert the surface to a texture
+    SDL_Texture *made = createTexture(surface);
+    // Get rid of the surface
+    SDL_FreeSurface(surface);
+    if (made == nullptr) {
+        string message = (string)"Failed to convert surface to texture!"
+            + (string)" Surface loaded from " + name + "\nSDL_Error: " 
+            + SDL_GetError() + "\n";
+        cerr << message;
+        throw message;
+    }
+
+    lock_guard<mutex> lock(m);
+    /* Another thread might have loaded the same one in the meantime. */
+    auto found = named.find(name);
+    if (found != named.end()) {
+        destroyTexture(made);
+        texture = found->second;
+        loaded[texture].count++;
+        return;
     }
 
     /* Add it to the list. */
+    texture = made;
     LoadedTexture newTexture;
     newTexture.name = name;
     newTexture.texture = texture;
     newTexture.count = 1;
-    loaded.push_back(newTexture);
-    m.unlock();
-
+    loaded[texture] = newTexture;
+    named[name] = texture;
 }
 
 Texture::Texture(string text, int size, int wrap_length) 
@@ -162,38 +202,52 @@ Texture::Texture(string text, int size, int wrap_length)
 
 Texture::Texture(string text, int size, int outline_size,
         Light color, Light outline_color, int wrap_length) {
-    m.lock();
-    texture = getText(text, size, outline_size, color, 
-        outline_color, wrap_length);
+    SDL_Surface *surface;
+    {
+        lock_guard<mutex> lock(m);
+        surface = getText(text, size, outline_size, color, outline_color, 
+            wrap_length);
+    }
+    texture = createTexture(surface);
+    SDL_FreeSurface(surface);
+    lock_guard<mutex> lock(m);
     addToLoaded();
-    m.unlock();
 }
 
 Texture::Texture(Uint32 pixelFormat, int access, int width, int height) {
+    Renderer::run([&]() {
+        texture = SDL_CreateTexture(Renderer::renderer, pixelFormat, access, 
+                width, height);
+        SetTextureBlendMode(SDL_BLENDMODE_BLEND);
+        /* Only a render target can be drawn to. Anything else gets its 
+        pixels some other way. */
+        if (!texture || access != SDL_TEXTUREACCESS_TARGET) {
+            return;
+        }
+        /* Draw alpha to the texture while we're at it. */
+        SetRenderTarget();
+        /* Set render draw color to alpha. */
+        Renderer::setColor(Light(0x00, 0x00, 0x00, 0x00));
+        Renderer::renderClear();
+        /* Set render color back to white. */
+        Renderer::setColorWhite();
+        /* And stop drawing to the texture. */
+        Renderer::setTarget(nullptr);
+    });
     /* This won't be reloaded, but it might be copy-constructed, so we need 
     to add it to the list. */
-    m.lock();
-    Renderer::m.lock();
-    texture = SDL_CreateTexture(Renderer::renderer, pixelFormat, access, 
-            width, height);
-    Renderer::m.unlock();
+    lock_guard<mutex> lock(m);
+    addToLoaded();
+}
+
+Texture::Texture(SDL_Surface *surface) {
+    texture = createTexture(surface);
+    lock_guard<mutex> lock(m);
     addToLoaded();
-    /* Draw alpha to the texture while we're at it. */
-    SetTextureBlendMode(SDL_BLENDMODE_BLEND);
-    m.unlock();
-    SetRenderTarget();
-    m.lock();
-    /* Set render draw color to alpha. */
-    Renderer::setColor(Light(0x00, 0x00, 0x00, 0x00));
-    Renderer::renderClear();
-    /* Set render color back to white. */
-    Renderer::setColorWhite();
-    /* And stop drawing to the texture. */
-    Renderer::setTarget(nullptr);
-    m.unlock();
 }
 
 Texture::Texture(const Texture &other) {
+    texture = nullptr;
     *this = other;
 }
 
@@ -203,33 +257,38 @@ Texture &Texture::operator=(const Texture &other) {
         return *this;
     }
 
-    texture = other.texture;
     m.lock();
+    /* Let go of the old texture after taking the new one, in case they're
+    the same. */
+    SDL_Texture *old = texture;
+    texture = other.texture;
     addToLoaded();
+    std::swap(old, texture);
+    removeFromLoaded();
+    texture = old;
     m.unlock();
     return *this;
 }
 
 Texture::~Texture() {
-    /* Check if it's in the list of loaded textures. */
     m.lock();
-    for (unsigned int i = 0; i < loaded.size(); i++) {
-        if (loaded[i].texture == texture) {
-            loaded[i].count--;
-            assert(loaded[i].count >= 0);
-            /* If there aren't any textures left, free the memory. */
-            if (loaded[i].count == 0) {
-                SDL_DestroyTexture(texture);
-                loaded.erase(loaded.begin() + i);
-            }
-            m.unlock();
-            return;
-        }
-    }
+    removeFromLoaded();
     m.unlock();
+}
+
+CacheStats Texture::getTextureStats() {
+    lock_guard<mutex> lock(m);
+    return textureStats;
+}
+
+CacheStats Texture::getFontStats() {
+    lock_guard<mutex> lock(m);
+    return fontStats;
+}
 
-    /* It wasn't in the list, so it should be destroyed. */
-    SDL_DestroyTexture(texture);
+int Texture::getLoadedCount() {
+    lock_guard<mutex> lock(m);
+    return loaded.size();
 }
 
 string Texture::getPath() {
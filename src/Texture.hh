@@ -5,6 +5,8 @@
 #include <SDL2/SDL_ttf.h>
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <functional>
 #include "Light.hh"
 #include "Renderer.hh"
 #include <mutex>
@@ -21,11 +23,35 @@ struct LoadedTexture {
     int count;
 };
 
-struct LoadedFont {
-    TTF_Font *font;
+/* What a font is looked up by. */
+struct FontKey {
     std::string name;
     int size;
     int outline; // nonzero iff font is an outline
+
+    inline bool operator==(const FontKey &other) const {
+        return name == other.name && size == other.size 
+            && outline == other.outline;
+    }
+};
+
+struct FontKeyHash {
+    inline size_t operator()(const FontKey &key) const {
+        size_t hash = std::hash<std::string>()(key.name);
+        hash ^= std::hash<int>()(key.size) + 0x9e3779b9 + (hash << 6) 
+            + (hash >> 2);
+        hash ^= std::hash<int>()(key.outline) + 0x9e3779b9 + (hash << 6) 
+            + (hash >> 2);
+        return hash;
+    }
+};
+
+/* How often the texture or font cache had what was asked for, for
+profiling. */
+struct CacheStats {
+    long long lookups;
+    long long hits;
+    long long misses;
 };
 
 /* A wrapper for SDL_Texture. Also avoids loading multiple copies of the same
@@ -36,23 +62,44 @@ class Texture {
     /* For multithreaded access to static variables. */
     static std::mutex m;
 
-    /* For keeping track of which textures have been loaded. */
-    static std::vector<LoadedTexture> loaded;
+    /* For keeping track of which textures have been loaded, and how many
+    Textures are using each. */
+    static std::unordered_map<SDL_Texture *, LoadedTexture> loaded;
+
+    /* The textures that were loaded from files, by filename. */
+    static std::unordered_map<std::string, SDL_Texture *> named;
 
     /* For keeping track of which fonts have been loaded. */
-    static std::vector<LoadedFont> fonts;
+    static std::unordered_map<FontKey, TTF_Font *, FontKeyHash> fonts;
 
-    /* Render text to a texture, with proper wrapping, and an outline. */
-    SDL_Texture *getText(std::string text, int size, 
+    /* How well the caches are doing. */
+    static CacheStats textureStats;
+    static CacheStats fontStats;
+
+    /* Render text to a surface, with proper wrapping, and an outline.
+    Requires m to be locked. */
+    SDL_Surface *getText(std::string text, int size, 
         int outline_size, Light color, Light outline_color, int wrap_length);
 
+    /* Make a texture from a surface on the render thread, and wait for it. 
+    This mustn't be called with m locked, since the render thread might be 
+    waiting for it. */
+    static SDL_Texture *createTexture(SDL_Surface *surface);
+
+    /* Destroy a texture on the render thread, whenever it gets to it. */
+    static void destroyTexture(SDL_Texture *texture);
+
     /* Return a font with the specified characteristics. */
     static TTF_Font *getFont(std::string name, int size, int outline);
 
     /* Add the texture to the list of loaded textures, or increase the count
-    if it's already there. */
+    if it's already there. Requires m to be locked. */
     void addToLoaded();
 
+    /* Decrease the count of the texture, destroying it if nothing else is
+    using it. Requires m to be locked. */
+    void removeFromLoaded();
+
 public:
     /* Constructor from filename of the picture. */
     Texture(const std::string &name);
@@ -67,6 +114,10 @@ public:
     the renderer, which is a global variable). */
     Texture(Uint32 pixelFormat, int access, int width, int height);
 
+    /* Constructor from a picture that's already loaded. If it can't be made
+    into a texture, the Texture won't have one. */
+    Texture(SDL_Surface *surface);
+
     /* Copy constructor. */
     Texture(const Texture &other);
 
@@ -99,11 +150,16 @@ public:
             assert(rectFrom.y >= 0);
             /* rectTo can have x or y less than 0, that just means it'll
             be rendered a bit off the screen. */
-            m.lock();
-            Renderer::m.lock();
             SDL_RenderCopy(Renderer::renderer, texture, &rectFrom, &rectTo);
-            Renderer::m.unlock();
-            m.unlock();
+        }
+    }
+
+    /* Draw triangles textured with this texture. */
+    inline void renderGeometry(const std::vector<SDL_Vertex> &vertices,
+            const std::vector<int> &indices) const {
+        if (texture) {
+            SDL_RenderGeometry(Renderer::renderer, texture, vertices.data(),
+                vertices.size(), indices.data(), indices.size());
         }
     }
 
@@ -115,9 +171,7 @@ public:
             SDL_Rect rectTo = {x, y, getWidth(), getHeight()};
             assert(rectTo.w != 0);
             assert(rectTo.h != 0);
-            Renderer::m.lock();
             SDL_RenderCopy(Renderer::renderer, texture, nullptr, &rectTo);
-            Renderer::m.unlock();
         }
     }
 
@@ -181,6 +235,34 @@ public:
         }
     }
 
+    /* Blend the texture as if its colors were already multiplied by its
+    alpha, which they are after blending things onto it while it's clear.
+    Return false if the renderer can't blend that way. */
+    inline bool SetTexturePremultiplied() {
+        SDL_BlendMode premultiplied = SDL_ComposeCustomBlendMode(
+            SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, 
+            SDL_BLENDOPERATION_ADD, SDL_BLENDFACTOR_ONE, 
+            SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+        return texture 
+            && SDL_SetTextureBlendMode(texture, premultiplied) == 0;
+    }
+
+    /* Whether stretching the texture uses the nearest pixel or blends
+    between them. */
+    inline void SetTextureScaleMode(SDL_ScaleMode scaleMode) {
+        if (texture) {
+            SDL_SetTextureScaleMode(texture, scaleMode);
+        }
+    }
+
+    /* Copy pixels into a streaming texture. pitch is the length of a row of
+    pixels, in bytes. */
+    inline void UpdateTexture(const void *pixels, int pitch) {
+        if (texture) {
+            SDL_UpdateTexture(texture, nullptr, pixels, pitch);
+        }
+    }
+
     inline void SetTextureAlphaMod(Uint8 a) {
         if (texture) {
             int success = SDL_SetTextureAlphaMod(texture, a);
@@ -192,19 +274,27 @@ public:
     }
 
     inline void SetRenderTarget() {
-        m.lock();
         Renderer::setTarget(texture);
-        m.unlock();
     }
 
     static inline void closeFonts() {
         m.lock();
-        for (unsigned int i = 0; i < fonts.size(); i++) {
-            TTF_CloseFont(fonts[i].font);
+        for (auto i = fonts.begin(); i != fonts.end(); i++) {
+            TTF_CloseFont(i->second);
         }
+        fonts.clear();
         m.unlock();
     }
 
+    /* Return how often textures loaded from files were already loaded. */
+    static CacheStats getTextureStats();
+
+    /* Return how often fonts were already open. */
+    static CacheStats getFontStats();
+
+    /* Return how many textures are loaded. */
+    static int getLoadedCount();
+
 };
 
 #endif
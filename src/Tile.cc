@@ -6,6 +6,9 @@
 #include "Map.hh"
 #include "Movable.hh"
 #include "json.hh"
+#include "AssetBundle.hh"
+#include "TileBatch.hh"
+#include "Atlas.hh"
 #include "filepaths.hh"
 #include <SDL2/SDL.h>
 #include "DroppedItem.hh"
@@ -125,23 +128,22 @@ bool Tile::getIsSolid() const {
     return isSolid;
 }
 
-void Tile::render(uint8_t spritePlace, const Light &light, 
+void Tile::render(TileBatch &batch, MapLayer layer, uint8_t spritePlace,
         const SDL_Rect &rectTo) {
     if (!sprite.hasTexture()) {
         return;
     }
 
-    /* Use darkness. */
-    sprite.setColorMod(light);
     Location spriteLocation;
-    SpaceInfo::fromSpritePlace(spriteLocation, spritePlace);
+    SpritePlace::fromSpritePlace(spriteLocation, spritePlace);
     assert(spriteLocation.x >= 0);
     assert(spriteLocation.y >= 0);
     assert(sprite.getWidth() > 0);
     assert(sprite.getHeight() > 0);
-    sprite.move(spriteLocation.x * sprite.getWidth(), 
-            spriteLocation.y * sprite.getHeight());
-    sprite.render(rectTo);
+    SDL_Rect rectFrom = {sheet.x + spriteLocation.x * sprite.getWidth(), 
+        sheet.y + spriteLocation.y * sprite.getHeight(), sprite.getWidth(), 
+        sprite.getHeight()};
+    batch.add(layer, *sprite.texture, rectFrom, rectTo);
 }
 
 
@@ -170,7 +172,7 @@ Location Tile::getSpritePlace(Map &map, const Location &place) const {
     sprite.cols / 2. */
     if (place.layer == MapLayer::BACKGROUND) {
         assert(canBackground);
-        answer.x += sprite.getCols() / 2;
+        answer.x += getSheetCols() / 2;
     }
 
     return answer;
@@ -200,14 +202,7 @@ bool Tile::update(Map &map, Location place,
 // Constructor, based on the tile type
 Tile::Tile(TileType tileType, string path) 
         : type(tileType) {
-    string filename = path + getFilename(tileType);
-    /* Put data in json. */
-    ifstream infile(filename);
-    /* Check that file was opened successfully. */
-    if (!infile) {
-        cerr << "Can't open " << filename << "\n";
-    }
-    json j = json::parse(infile);
+    const json &j = AssetBundle::getJson(path + getFilename(tileType));
     /* Set each of this tile's non-const values equal to the json's values. */
     sprite = j["sprite"].get<Sprite>();
     color = j["color"].get<Light>();
@@ -225,7 +220,16 @@ Tile::Tile(TileType tileType, string path)
     tier = j["tier"];
     int edgeInt = j["edgeType"];
     edgeType = (EdgeType)edgeInt;
-    sprite.loadTexture(path + TILE_SPRITE_PATH);
+    /* Use the atlas if the spritesheet is in it. */
+    if (sprite.name == "" || !Atlas::find(path + TILE_SPRITE_PATH 
+            + sprite.name, sprite.texture, sheet)) {
+        sprite.loadTexture(path + TILE_SPRITE_PATH);
+        sheet = {0, 0, 0, 0};
+        if (sprite.hasTexture()) {
+            sheet.w = sprite.getTextureWidth();
+            sheet.h = sprite.getTextureHeight();
+        }
+    }
 
     assert(absorbed.r >= 1.0);
     assert(absorbed.g >= 1.0);
@@ -242,6 +246,3 @@ Tile::~Tile() {}
 bool Tile::canUpdate(const Map &map, const Location &place) {
     return isAnimated;
 }
-
-void Tile::render(uint8_t spritePlace, const Light &light, 
-        const SDL_Rect &rectTo);
@@ -13,6 +13,8 @@ class Map;
 struct Location;
 struct SDL_Rect;
 class DroppedItem;
+class TileBatch;
+enum class MapLayer;
 
 // A class for keeping track of which tiles there are
 enum class TileType : short {
@@ -89,7 +91,9 @@ class Tile {
     Light emitted;
 
     /* How much light it blocks for each color, aside from the amount lost by
-    distance, for edges. */
+    distance, for edges. Giving the colors different amounts tints the light
+    that gets through. a is the fraction of that it blocks when it's in the
+    background. */
     DLight absorbed;
 
     /* Whether it is a source of natural light. For instance, an empty tile
@@ -118,6 +122,15 @@ protected:
     // variations.
     Sprite sprite;
 
+    /* Where the spritesheet is in the sprite's texture. That's all of it,
+    unless the texture is the atlas every tile spritesheet is packed into. */
+    SDL_Rect sheet;
+
+    /* The number of columns in the spritesheet. */
+    inline int getSheetCols() const {
+        return sheet.w / sprite.getWidth();
+    }
+
     /* Return the filename of the json file for that tiletype. */
     static std::string getFilename(TileType tileType);
 
@@ -130,6 +143,11 @@ public:
         return isSky;
     }
 
+    /* Whether its sprite changes on its own every so often. */
+    inline bool getIsAnimated() const {
+        return isAnimated;
+    }
+
     inline Light getColor() const {
         return color;
     }
@@ -156,7 +174,7 @@ public:
 
     /* The number of foreground and background columns in the spritesheet. */
     inline int numSprites() const {
-        return sprite.getCols() / (2 - !canBackground);
+        return getSheetCols() / (2 - !canBackground);
     }
 
     // Variables for how it interacts with the players
@@ -188,7 +206,9 @@ public:
     /* Whether the tile will ever need to call its update function. */
     virtual bool canUpdate(const Map &map, const Location &place);
 
-    virtual void render(uint8_t spritePlace, const Light &light, 
+    /* Add the tile to a batch of tiles to be drawn, without any lighting. The
+    light gets multiplied in afterwards for the whole screen at once. */
+    virtual void render(TileBatch &batch, MapLayer layer, uint8_t spritePlace,
         const SDL_Rect &rectTo);
 };
 
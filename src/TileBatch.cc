@@ -0,0 +1,58 @@
+#include "TileBatch.hh"
+#include <cassert>
+
+using namespace std;
+
+void TileBatch::add(MapLayer layer, const Texture &texture,
+        const SDL_Rect &rectFrom, const SDL_Rect &rectTo) {
+    assert(layer == MapLayer::BACKGROUND || layer == MapLayer::FOREGROUND);
+    TextureQuads &quads = (layer == MapLayer::BACKGROUND ? background
+        : foreground)[&texture];
+    /* Look the size up again whenever it starts being used, in case a
+    different texture ended up at the same address. */
+    if (quads.vertices.empty()) {
+        quads.width = texture.getWidth();
+        quads.height = texture.getHeight();
+    }
+
+    float left = rectFrom.x / quads.width;
+    float right = (rectFrom.x + rectFrom.w) / quads.width;
+    float top = rectFrom.y / quads.height;
+    float bottom = (rectFrom.y + rectFrom.h) / quads.height;
+    SDL_Color white = {0xFF, 0xFF, 0xFF, 0xFF};
+
+    int first = quads.vertices.size();
+    quads.vertices.push_back({{(float)rectTo.x, (float)rectTo.y}, white,
+        {left, top}});
+    quads.vertices.push_back({{(float)(rectTo.x + rectTo.w),
+        (float)rectTo.y}, white, {right, top}});
+    quads.vertices.push_back({{(float)(rectTo.x + rectTo.w),
+        (float)(rectTo.y + rectTo.h)}, white, {right, bottom}});
+    quads.vertices.push_back({{(float)rectTo.x,
+        (float)(rectTo.y + rectTo.h)}, white, {left, bottom}});
+
+    /* Two triangles. */
+    quads.indices.push_back(first);
+    quads.indices.push_back(first + 1);
+    quads.indices.push_back(first + 2);
+    quads.indices.push_back(first + 2);
+    quads.indices.push_back(first + 3);
+    quads.indices.push_back(first);
+}
+
+void TileBatch::render(unordered_map<const Texture *, TextureQuads> &layer) {
+    for (auto i = layer.begin(); i != layer.end(); i++) {
+        TextureQuads &quads = i -> second;
+        if (quads.vertices.empty()) {
+            continue;
+        }
+        i -> first -> renderGeometry(quads.vertices, quads.indices);
+        quads.vertices.clear();
+        quads.indices.clear();
+    }
+}
+
+void TileBatch::render() {
+    render(background);
+    render(foreground);
+}
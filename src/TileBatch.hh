@@ -0,0 +1,45 @@
+#ifndef TILEBATCH_HH
+#define TILEBATCH_HH
+
+#include <vector>
+#include <unordered_map>
+#include <SDL2/SDL.h>
+#include "Texture.hh"
+#include "MapHelpers.hh"
+
+/* The quads of everything drawn from one texture, ready for
+SDL_RenderGeometry. */
+struct TextureQuads {
+    /* The size of the texture, for turning pixels into texture
+    coordinates. */
+    float width, height;
+
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+/* Collects the tiles to be drawn, and then draws all of them with one
+SDL_RenderGeometry call per texture per layer, instead of one SDL_RenderCopy
+for each tile. Tiles in the same layer never overlap, so the order they're
+drawn in within a layer doesn't matter, but every background tile gets drawn
+before any foreground tile. */
+class TileBatch {
+    /* The quads in each layer, by texture. Entries are kept after they're
+    drawn so their vectors don't have to be allocated again. */
+    std::unordered_map<const Texture *, TextureQuads> background;
+    std::unordered_map<const Texture *, TextureQuads> foreground;
+
+    /* Draw all the quads in a layer, and empty it. */
+    static void render(
+        std::unordered_map<const Texture *, TextureQuads> &layer);
+
+public:
+    /* Add a quad to be drawn, which copies rectFrom of texture to rectTo. */
+    void add(MapLayer layer, const Texture &texture, const SDL_Rect &rectFrom,
+        const SDL_Rect &rectTo);
+
+    /* Draw everything that was added since the last time, and forget it. */
+    void render();
+};
+
+#endif
@@ -15,6 +15,9 @@
 #include "Rect.hh"
 #include "World.hh"
 
+/* How many frames a chunk's texture is kept after it goes off the screen. */
+#define CHUNK_CACHE_FRAMES 120
+
 using namespace std;
 
 // Return a rectangle in world coordinates for a player at x, y
@@ -93,6 +96,9 @@ WindowHandler::WindowHandler(int screenWidth, int screenHeight,
         TILE_WIDTH(tileWidth), TILE_HEIGHT(tileHeight) {
     window = NULL;
     screenSurface = NULL;
+    smoothLight = false;
+    frameRate = FrameRate::CAPPED;
+    frame = 0;
 
     // Set the 2D vector of rects for the tiles
     resize(screenWidth, screenHeight);
@@ -125,6 +131,23 @@ void WindowHandler::resize(int width, int height) {
 void WindowHandler::setMapSize(int tilesWide, int tilesHigh) {
     worldWidth = tilesWide * TILE_WIDTH;
     worldHeight = tilesHigh * TILE_HEIGHT;
+    /* Whatever's cached is from a different map. */
+    chunkCache.clear();
+}
+
+void WindowHandler::setSmoothLight(bool smooth) {
+    smoothLight = smooth;
+    lightMap.SetTextureScaleMode(getLightScaleMode());
+}
+
+void WindowHandler::setFrameRate(FrameRate rate) {
+    if (SDL_RenderSetVSync(Renderer::renderer, rate == FrameRate::VSYNC)
+            != 0 && rate == FrameRate::VSYNC) {
+        cerr << "Can't turn on vsync. SDL_Error: " << SDL_GetError() << "\n";
+        SDL_RenderSetVSync(Renderer::renderer, 0);
+        rate = FrameRate::CAPPED;
+    }
+    frameRate = rate;
 }
 
 // Start up the window
@@ -148,7 +171,6 @@ void WindowHandler::init() {
         }
         else {
             // Create a renderer for the window
-            Renderer::m.lock();
             Renderer::renderer = SDL_CreateRenderer(window, -1, 
                                             SDL_RENDERER_ACCELERATED);
 
@@ -161,12 +183,14 @@ void WindowHandler::init() {
                                             SDL_RENDERER_SOFTWARE);
             }
             if (Renderer::renderer == NULL) {
-                Renderer::m.unlock();
                 string message = (string)"Software-accelerated renderer could "
                         + "not be created. SDL_Error: " + SDL_GetError() + "\n";
                 throw message;
             }
             else {
+                /* This is the only thread that gets to use it. */
+                Renderer::m.lock();
+                Renderer::renderThread = this_thread::get_id();
                 Renderer::m.unlock();
                 // Initialize renderer draw color
                 Renderer::setColorWhite();
@@ -192,6 +216,109 @@ void WindowHandler::init() {
     isMinimized = false;
 }
 
+void WindowHandler::batchTile(Map &m, int x, int y, const SDL_Rect &rectTo,
+        TileBatch &batch) {
+    m.getBackground(x, y) -> render(batch, MapLayer::BACKGROUND, 
+        m.getBackgroundSprite(x, y), rectTo);
+    m.getForeground(x, y) -> render(batch, MapLayer::FOREGROUND, 
+        m.getForegroundSprite(x, y), rectTo);
+}
+
+bool WindowHandler::drawChunk(Map &m, int chunkX, int chunkY, 
+        CachedChunk &cached) {
+    if (!cached.texture.hasTexture()) {
+        cached.texture = Texture(SDL_PIXELFORMAT_ARGB8888, 
+            SDL_TEXTUREACCESS_TARGET, CHUNK_SIZE * TILE_WIDTH, 
+            CHUNK_SIZE * TILE_HEIGHT);
+        /* The tiles are blended onto a clear texture, so its colors end up
+        multiplied by their alpha already, and normal blending would apply
+        it a second time. */
+        if (!cached.texture.SetTexturePremultiplied()) {
+            cached.texture = Texture();
+            return false;
+        }
+    }
+    cached.version = m.getRenderVersion(chunkX * CHUNK_SIZE, 
+        chunkY * CHUNK_SIZE);
+    cached.animated.clear();
+
+    cached.texture.SetRenderTarget();
+    Renderer::setColor(0x00, 0x00, 0x00, 0x00);
+    Renderer::renderClear();
+    Renderer::setColorWhite();
+
+    SDL_Rect rectTo;
+    rectTo.w = TILE_WIDTH;
+    rectTo.h = TILE_HEIGHT;
+    for (int row = 0; row < CHUNK_SIZE; row++) {
+        /* The top of the texture is the top row of the chunk. */
+        rectTo.y = (CHUNK_SIZE - 1 - row) * TILE_HEIGHT;
+        int y = chunkY * CHUNK_SIZE + row;
+        for (int column = 0; column < CHUNK_SIZE; column++) {
+            rectTo.x = column * TILE_WIDTH;
+            int x = chunkX * CHUNK_SIZE + column;
+            /* The last chunks in each direction can hang off the map. */
+            if (x >= m.getWidth() || y >= m.getHeight()) {
+                continue;
+            }
+            if (m.getForeground(x, y) -> getIsAnimated()
+                    || m.getBackground(x, y) -> getIsAnimated()) {
+                cached.animated.push_back(row * CHUNK_SIZE + column);
+                continue;
+            }
+            batchTile(m, x, y, rectTo, chunkTiles);
+        }
+    }
+    chunkTiles.render();
+    Renderer::setTarget(nullptr);
+    return true;
+}
+
+void WindowHandler::renderChunk(Map &m, int chunkX, int chunkY, int left, 
+        int top) {
+    int chunksWide = (m.getWidth() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    CachedChunk &cached = chunkCache[chunkY * chunksWide + chunkX];
+    cached.lastDrawn = frame;
+
+    SDL_Rect rectTo;
+    rectTo.w = TILE_WIDTH;
+    rectTo.h = TILE_HEIGHT;
+    if (!cached.texture.hasTexture() || cached.version 
+            != m.getRenderVersion(chunkX * CHUNK_SIZE, chunkY * CHUNK_SIZE)) {
+        if (!drawChunk(m, chunkX, chunkY, cached)) {
+            /* Without a texture to draw to, every tile has to be drawn
+            straight to the screen. */
+            for (int row = 0; row < CHUNK_SIZE; row++) {
+                int y = chunkY * CHUNK_SIZE + row;
+                rectTo.y = top + (CHUNK_SIZE - 1 - row) * TILE_HEIGHT;
+                for (int column = 0; column < CHUNK_SIZE; column++) {
+                    int x = chunkX * CHUNK_SIZE + column;
+                    rectTo.x = left + column * TILE_WIDTH;
+                    if (x < m.getWidth() && y < m.getHeight()) {
+                        batchTile(m, x, y, rectTo, screenTiles);
+                    }
+                }
+            }
+            return;
+        }
+    }
+
+    SDL_Rect chunkFrom = {0, 0, CHUNK_SIZE * TILE_WIDTH, 
+        CHUNK_SIZE * TILE_HEIGHT};
+    SDL_Rect chunkTo = {left, top, CHUNK_SIZE * TILE_WIDTH, 
+        CHUNK_SIZE * TILE_HEIGHT};
+    cached.texture.render(chunkFrom, chunkTo);
+
+    for (unsigned int i = 0; i < cached.animated.size(); i++) {
+        int row = cached.animated[i] / CHUNK_SIZE;
+        int column = cached.animated[i] % CHUNK_SIZE;
+        rectTo.x = left + column * TILE_WIDTH;
+        rectTo.y = top + (CHUNK_SIZE - 1 - row) * TILE_HEIGHT;
+        batchTile(m, chunkX * CHUNK_SIZE + column, 
+            chunkY * CHUNK_SIZE + row, rectTo, screenTiles);
+    }
+}
+
 // Render everything the map holds information about
 // x and y are the center of view of the camera, in pixels, 
 // where y = 0 at the bottom
@@ -203,11 +330,6 @@ void WindowHandler::renderMap(Map &m, const Rect &camera) {
     assert(camera.x >= 0);
     assert(camera.y >= 0);
 
-    // Rectangle to draw to
-    SDL_Rect rectTo;
-    rectTo.w = TILE_WIDTH;
-    rectTo.h = TILE_HEIGHT;
-
     // Iterate through every tile at least partially within the camera
     int width = ceil((float)camera.w / (float)TILE_WIDTH) + 1;
     int height = ceil((float)camera.h / (float)TILE_HEIGHT) + 1;
@@ -216,51 +338,106 @@ void WindowHandler::renderMap(Map &m, const Rect &camera) {
 
     /* Make sure the lights are updated. */
     m.setLight(xMapStart, yMapStart - height, xMapStart + width, yMapStart);
+    m.setDynamicLight(xMapStart, yMapStart - height, xMapStart + width, 
+        yMapStart + 1);
 
     assert(width != 0);
     assert(height != 0);
+
+    /* Draw the chunks the screen overlaps, left to right. The column the
+    left edge of the screen is in is counted without wrapping, so that
+    chunks past the seam where the map wraps go to the right of it. */
+    int yLow = max(0, yMapStart - height + 1);
+    int yHigh = min(m.getHeight() - 1, yMapStart);
+    int column = camera.x / TILE_WIDTH;
+    int x = xMapStart;
+    while (column < camera.x / TILE_WIDTH + width && yLow <= yHigh) {
+        int chunkX = x / CHUNK_SIZE;
+        int chunkLeft = chunkX * CHUNK_SIZE;
+        int chunkRight = min(chunkLeft + CHUNK_SIZE, m.getWidth());
+        int left = (column - (x - chunkLeft)) * TILE_WIDTH - camera.x;
+        for (int chunkY = yLow / CHUNK_SIZE; chunkY <= yHigh / CHUNK_SIZE;
+                chunkY++) {
+            // Remember that screen y == 0 at the top but world y == 0 at
+            // the bottom.
+            int chunkTop = (chunkY + 1) * CHUNK_SIZE - 1;
+            int top = (camera.h + camera.y) % TILE_HEIGHT;
+            top += (yMapStart - chunkTop - 1) * TILE_HEIGHT;
+            renderChunk(m, chunkX, chunkY, left, top);
+        }
+        column += chunkRight - x;
+        x = chunkRight % m.getWidth();
+    }
+
+    /* The animated tiles, and any tiles from chunks that couldn't be cached,
+    go on top of all the chunks at once. */
+    screenTiles.render();
+
+    /* Let go of the chunks that haven't been on the screen in a while. */
+    for (auto i = chunkCache.begin(); i != chunkCache.end(); ) {
+        if (frame - i -> second.lastDrawn > CHUNK_CACHE_FRAMES) {
+            i = chunkCache.erase(i);
+        }
+        else {
+            i++;
+        }
+    }
+    frame++;
+
+    if (!lightMap.hasTexture() || lightMap.getWidth() != width
+            || lightMap.getHeight() != height) {
+        lightMap = Texture(SDL_PIXELFORMAT_ARGB8888, 
+            SDL_TEXTUREACCESS_STREAMING, width, height);
+        lightMap.SetTextureBlendMode(SDL_BLENDMODE_MOD);
+        lightMap.SetTextureScaleMode(getLightScaleMode());
+    }
+    lightPixels.resize(width * height);
+
     for (int i = 0; i < width; i++) {
-        rectTo.x = i * TILE_WIDTH - (camera.x % TILE_WIDTH);
         for (int j = 0; j < height; j++) {
-            // Remember that screen y == 0 at the top but world y == 0 at 
-            // the bottom. Here j == 0 at the top of the screen.
-            // We're not using convertRect because that doesn't align them
-            // with the tile grid.
-            rectTo.y = (camera.h + camera.y) % TILE_HEIGHT;
-            rectTo.y += (j - 1) * TILE_HEIGHT;
-
-            // Render the tile
+            // Here j == 0 at the top of the screen.
             int xTile = (xMapStart + i) % m.getWidth();
             int yTile = yMapStart - j;
-            // But only if it's a tile that exists on the map
             assert (0 <= xTile);
             assert (xTile < m.getWidth());
+            /* White leaves whatever is behind alone, which is what the sky
+            should look like above and below the map. */
+            Uint32 &texel = lightPixels[j * width + i];
+            texel = 0xFFFFFFFF;
             if (!m.isOnMap(xTile, yTile)) {
                 continue;
             }
 
-            /* Modulate the color due to lighting. */
+            /* Tiles with nothing in them get their light too, even though
+            only the sky color is behind them, so that smooth lighting 
+            doesn't fade the tiles around them towards white. */
             Light light = m.getLight(xTile, yTile);
-            light.a = 255;
-            uint8_t background = m.getBackgroundSprite(xTile, yTile);
-            uint8_t foreground = m.getForegroundSprite(xTile, yTile);
-            m.getBackground(xTile, yTile) -> render(background, light, rectTo);
-            m.getForeground(xTile, yTile) -> render(foreground, light, rectTo);
+            texel = 0xFF000000 | (light.r << 16) | (light.g << 8) | light.b;
         }
     }
+
+    /* Darken everything that was just drawn, all at once. */
+    lightMap.UpdateTexture(lightPixels.data(), width * sizeof(Uint32));
+    SDL_Rect lightFrom = {0, 0, width, height};
+    SDL_Rect lightTo;
+    lightTo.x = -(camera.x % TILE_WIDTH);
+    lightTo.y = (camera.h + camera.y) % TILE_HEIGHT - TILE_HEIGHT;
+    lightTo.w = width * TILE_WIDTH;
+    lightTo.h = height * TILE_HEIGHT;
+    lightMap.render(lightFrom, lightTo);
 }
 
 // Update the screen
-void WindowHandler::update(World &world) {
-    /* Find the camera. */
+void WindowHandler::update(World &world, double alpha) {
+    /* Find the camera, following the player where they're drawn so they
+    stay still on the screen. */
     int w = world.player.getWidth();
     int h = world.player.getHeight();
-    Rect camera = findCamera(world.player.getRect().x, 
-        world.player.getRect().y, w, h);
+    Rect playerDrawn = world.player.getRenderRect(alpha);
+    Rect camera = findCamera(playerDrawn.x, playerDrawn.y, w, h);
     /* Tell the player where on the screen they are. This is only used by
     EventHandler. TODO: remove. */
-    SDL_Rect playerRect = { world.player.getRect().x, 
-        world.player.getRect().y, w, h };
+    SDL_Rect playerRect = { playerDrawn.x, playerDrawn.y, w, h };
     world.player.convertRect(playerRect, camera);
     world.player.screenX = playerRect.x;
     world.player.screenY = playerRect.y + playerRect.h;
@@ -284,10 +461,10 @@ void WindowHandler::update(World &world) {
 
         // Draw any movables
         for (unsigned int i = 0; i < world.entities.size(); i++) {
-            world.entities[i] -> render(camera);
+            world.entities[i] -> render(camera, alpha);
         }
         for (unsigned int i = 0; i < world.droppedItems.size(); i++) {
-            world.droppedItems[i] -> render(camera);
+            world.droppedItems[i] -> render(camera, alpha);
         }
 
         // Draw the UI
@@ -300,11 +477,11 @@ void WindowHandler::update(World &world) {
 
 // Close the window, clean up, and exit SDL
 void WindowHandler::close() {
-    /* Destroy window and renderer. */
-    Renderer::m.lock();
+    /* Destroy window and renderer, after anything other threads were still
+    waiting to have done with it. */
+    Renderer::doQueued();
     SDL_DestroyRenderer(Renderer::renderer);
     Renderer::renderer = NULL;
-    Renderer::m.unlock();
     SDL_DestroyWindow(window);
     window = NULL;
 
@@ -9,11 +9,13 @@ the only thing screen coordinates are used for. */
 
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include <SDL2/SDL.h>
 
 #include "Renderer.hh"
 #include "Sprite.hh"
 #include "Movable.hh"
+#include "TileBatch.hh"
 #include "filepaths.hh"
 
 // Forawrd declare
@@ -28,6 +30,34 @@ struct MouseBox;
 struct StatBar;
 class World;
 
+/* One of the map's chunks with its tiles drawn to a texture, so that it can
+be put on the screen all at once instead of tile by tile. */
+struct CachedChunk {
+    Texture texture;
+
+    /* The chunk's render version when it was drawn. */
+    unsigned int version;
+
+    /* The animated tiles in the chunk, as row * CHUNK_SIZE + column. They're
+    left out of the texture and drawn separately every frame, so that they
+    can change without the whole chunk being drawn again. */
+    std::vector<int> animated;
+
+    /* The last frame the chunk was on the screen. */
+    unsigned int lastDrawn;
+};
+
+/* How often the screen gets drawn. The world always updates at the same
+rate no matter which of these is used. */
+enum class FrameRate {
+    /* Once per world update. */
+    CAPPED,
+    /* As often as possible. */
+    UNCAPPED,
+    /* Once per refresh of the monitor. */
+    VSYNC
+};
+
 // A class to open a window and display things to it
 class WindowHandler {
     // Fields
@@ -56,12 +86,52 @@ class WindowHandler {
     // A 2D vector of SLD rects for rendering the map
     std::vector<std::vector<SDL_Rect>> tileRects;
 
+    /* The light on each tile on the screen, one texel per tile. It gets
+    stretched over the tiles and multiplied with them after they're drawn,
+    so the tiles themselves don't need their colors changed. */
+    Texture lightMap;
+    std::vector<Uint32> lightPixels;
+
+    /* Whether the light map is blended between tiles when it's stretched, 
+    instead of each tile getting one flat light. */
+    bool smoothLight;
+
+    /* The chunks that have been on the screen recently, by chunk x and y, 
+    and how many frames have been drawn. */
+    std::unordered_map<int, CachedChunk> chunkCache;
+    unsigned int frame;
+
+    /* The tiles to go straight on the screen this frame, and the tiles
+    being drawn to a chunk's texture. */
+    TileBatch screenTiles;
+    TileBatch chunkTiles;
+
+    /* How often to draw the screen. */
+    FrameRate frameRate;
+
+    /* How the light map should be stretched. */
+    inline SDL_ScaleMode getLightScaleMode() const {
+        return smoothLight ? SDL_ScaleModeLinear : SDL_ScaleModeNearest;
+    }
+
     // Private methods
 
     // Return a rectangle in world coordinates, for a player at x, y
     // w and h are the width and height of the player sprite.
     Rect findCamera(int x, int y, int w, int h);
 
+    /* Add the background and foreground of the tile at x, y to a batch. */
+    void batchTile(Map &m, int x, int y, const SDL_Rect &rectTo, 
+        TileBatch &batch);
+
+    /* Draw the tiles of a chunk to its cached texture. Return false if the
+    texture couldn't be made. */
+    bool drawChunk(Map &m, int chunkX, int chunkY, CachedChunk &cached);
+
+    /* Put a chunk on the screen with its top left corner at left, top,
+    drawing it again first if it's changed. */
+    void renderChunk(Map &m, int chunkX, int chunkY, int left, int top);
+
     // Render everything UI
     void renderUI(Player &player, std::string path);
 
@@ -84,6 +154,19 @@ public:
     void setMinimized(bool minimized);
     void resize(int width, int height);
     void setMapSize(int tilesWide, int tilesHigh);
+    void setSmoothLight(bool smooth);
+
+    inline bool getSmoothLight() const {
+        return smoothLight;
+    }
+
+    /* Set how often to draw the screen. Falls back to CAPPED if vsync can't
+    be turned on. */
+    void setFrameRate(FrameRate rate);
+
+    inline FrameRate getFrameRate() const {
+        return frameRate;
+    }
 
     inline int getWidth() {
         return screenWidth;
@@ -98,8 +181,9 @@ public:
     // where y = 0 is at the bottom
     void renderMap(Map &m, const Rect &camera);
 
-    // Update the screen
-    void update(World &world);
+    /* Update the screen, with everything that moves drawn alpha of the way
+    from where it was before the last world update to where it is now. */
+    void update(World &world, double alpha);
 };
 
 #endif
@@ -0,0 +1,78 @@
+#include "WorkerPool.hh"
+#include <cassert>
+
+using namespace std;
+
+WorkerPool::WorkerPool(int count) {
+    job = nullptr;
+    pieces = 0;
+    next = 0;
+    done = 0;
+    generation = 0;
+    stopping = false;
+    for (int i = 0; i < count; i++) {
+        threads.emplace_back(&WorkerPool::work, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        lock_guard<mutex> lock(m);
+        stopping = true;
+    }
+    started.notify_all();
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+void WorkerPool::doPieces(unique_lock<mutex> &lock) {
+    while (next < pieces) {
+        int piece = next;
+        next++;
+        const function<void(int)> &current = *job;
+        lock.unlock();
+        current(piece);
+        lock.lock();
+        done++;
+        if (done == pieces) {
+            finished.notify_all();
+        }
+    }
+}
+
+void WorkerPool::work() {
+    unique_lock<mutex> lock(m);
+    unsigned long seen = generation;
+    while (true) {
+        started.wait(lock, [&]() {
+            return stopping || generation != seen;
+        });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        doPieces(lock);
+    }
+}
+
+void WorkerPool::run(int count, const function<void(int)> &newJob) {
+    if (count <= 0) {
+        return;
+    }
+    unique_lock<mutex> lock(m);
+    assert(done == pieces);
+    job = &newJob;
+    pieces = count;
+    next = 0;
+    done = 0;
+    generation++;
+    started.notify_all();
+
+    /* Help out instead of just waiting. */
+    doPieces(lock);
+    finished.wait(lock, [&]() {
+        return done == pieces;
+    });
+    job = nullptr;
+}
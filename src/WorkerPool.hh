@@ -0,0 +1,63 @@
+#ifndef WORKERPOOL_HH
+#define WORKERPOOL_HH
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/* A set of threads that stay around between jobs, so that work that happens
+every frame can be split up without starting new threads every frame. A job
+is split into numbered pieces, which get handed out to the workers and to the
+thread that asked for the job to be done. */
+class WorkerPool {
+    std::vector<std::thread> threads;
+
+    /* For access to everything below. */
+    std::mutex m;
+
+    /* For telling the workers there's a new job, and for telling the thread
+    that started it that the job's done. */
+    std::condition_variable started;
+    std::condition_variable finished;
+
+    /* The job being done, how many pieces it has, the next one to hand out,
+    and how many are done. */
+    const std::function<void(int)> *job;
+    int pieces;
+    int next;
+    int done;
+
+    /* Goes up by one for each job, so workers can tell there's a new one. */
+    unsigned long generation;
+
+    /* Whether the workers should stop. */
+    bool stopping;
+
+    /* Do pieces of the current job until there aren't any left. Requires
+    the lock to be held, and still holds it afterwards. */
+    void doPieces(std::unique_lock<std::mutex> &lock);
+
+    /* What each worker thread runs. */
+    void work();
+
+public:
+    /* Start a pool with count worker threads. */
+    WorkerPool(int count);
+
+    /* Stops and joins all the workers. */
+    ~WorkerPool();
+
+    /* Return how many threads jobs are split over, including the one
+    calling run. */
+    inline int getThreads() const {
+        return threads.size() + 1;
+    }
+
+    /* Call job(i) for each i from 0 to count - 1, split over the workers and
+    this thread, and return once they've all finished. */
+    void run(int count, const std::function<void(int)> &job);
+};
+
+#endif
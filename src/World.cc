@@ -21,7 +21,23 @@ World::~World() {
     }
 }
 
+void World::addEmitter(const movable::Movable &movable) {
+    Light emitted = movable.getEmitted();
+    if (emitted.r != 0 || emitted.g != 0 || emitted.b != 0) {
+        map.addEmitter(movable.getCenterX() / map.getTileWidth(),
+            movable.getCenterY() / map.getTileHeight(), emitted);
+    }
+}
+
 void World::update() {
+    /* Remember where everything was, so it can be drawn moving smoothly
+    between here and wherever it ends up. */
+    for (unsigned int i = 0; i < entities.size(); i++) {
+        entities[i] -> savePosition();
+    }
+    for (unsigned int i = 0; i < droppedItems.size(); i++) {
+        droppedItems[i] -> savePosition();
+    }
 
     /* TODO: update all entities. */
     player.update(droppedItems);
@@ -64,4 +80,13 @@ void World::update() {
     /* Have the map update itself and relevent entities. */
     map.update(droppedItems);
 
+    /* Tell the map where everything that gives off light is now. */
+    map.clearEmitters();
+    for (unsigned int i = 0; i < entities.size(); i++) {
+        addEmitter(*entities[i]);
+    }
+    for (unsigned int i = 0; i < droppedItems.size(); i++) {
+        addEmitter(*droppedItems[i]);
+    }
+
 }
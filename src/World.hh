@@ -20,6 +20,9 @@ public:
 private:
     Collider collider;
 
+    /* Tell the map about a movable that gives off light. */
+    void addEmitter(const movable::Movable &movable);
+
     /* How many ticks since the map was loaded. */
     unsigned int tick;
 
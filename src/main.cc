@@ -1,4 +1,6 @@
 #include "Game.hh"
+#include "AllTheItems.hh"
+#include "Atlas.hh"
 #include <iostream>
 #include <string>
 #include <libgen.h> // For dirname
@@ -19,7 +21,9 @@ int main(int argc, char **argv) {
 
     Game game(path);
     game.run();
-    // Clean up fonts
+    // Clean up item prototypes, the atlas, and fonts
+    ItemMaker::clearPrototypes();
+    Atlas::clear();
     Texture::closeFonts();
     return 0;
 }